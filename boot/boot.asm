@@ -44,8 +44,10 @@ align 4
 ; System V ABI standard and de-facto extensions. The compiler will assume the
 ; stack is properly aligned and failure to align the stack will result in
 ; undefined behavior.
-section .bss
-align 16
+; The stack is also aligned like a thread stack (STACK_ALIGN in thread.h) so
+; kmain can be treated as the initial thread.
+section .bss align=32768
+alignb 32768
 stack_bottom:
 resb 16384 ; 16 KiB
 stack_top:
@@ -1,15 +1,27 @@
 /* This file is for reading a .bmp file for an image. */
 
 /* includes */
+#include <stdbool.h>
+#include <mem.h>
+#include <kerrors.h>
 #include "bmp.h"
+#include "../kernel/kalloc.h"
 
 /* defines */
+#define INFO_HEADER_OFFSET 14   // the info header starts right after the 14 byte file header
 
 /* globals */
 static uint8_t *start_pos = NULL;
 static uint32_t img_size = 0;
 
+/* prototypes */
+static uint32_t bmp_data_size(bmp_file_header_t *header);
+static uint32_t bmp_surface_pages(bmp_file_header_t *header);
+static void bmp_decode_rows(bmp_file_header_t *header);
+static void bmp_decode_rle8(bmp_file_header_t *header);
+
 /** reads the header of a bmp file at file into buf
+ * 24 and 32-bit images and 8-bit palettized images, either uncompressed or RLE8, are supported
  * 
  * @param file: pointer to the beginning of the .bmp file
  * @param buf: pointer to a bmp_file_header for the contents of the file
@@ -17,8 +29,14 @@ static uint32_t img_size = 0;
  * @return -1 if the file wasn't read correctly, otherwise the amount of bytes read
  */
 int read_bmp_header(uint8_t *file, bmp_file_header_t *buf) {
+    uint8_t *start = file;
     int num_read = 0;
 
+    buf->data = NULL;
+    buf->pixels = NULL;
+    buf->color_table = NULL;
+    buf->palette_size = 0;
+
     // read in bmp header
     buf->header.signature = *((uint16_t *) file);
     file += 2;
@@ -27,10 +45,8 @@ int read_bmp_header(uint8_t *file, bmp_file_header_t *buf) {
     buf->header.data_offset = *((uint32_t *) file);
     file += 4;
     
-    if (buf->header.file_size < HEADER_SIZE + HEADER_INFO_SIZE) {
-        buf->data = NULL;
+    if (buf->header.signature != BMP_SIGNATURE || buf->header.file_size < HEADER_SIZE + HEADER_INFO_SIZE)
         return -1;
-    }
 
     num_read += HEADER_SIZE;
 
@@ -60,16 +76,33 @@ int read_bmp_header(uint8_t *file, bmp_file_header_t *buf) {
 
     num_read += HEADER_INFO_SIZE;
 
-    // we don't support non 24-bit colors
-    if (buf->info_header.bpp < 24) {
-        buf->data = NULL;
+    uint16_t bpp = buf->info_header.bpp;
+    uint32_t compression = buf->info_header.compression;
+    bool rgb = (bpp == 24 || bpp == 32) && compression == BMP_RGB;
+    bool palettized = bpp == 8 && (compression == BMP_RGB || compression == BMP_RLE8);
+
+    // top down (negative height) images aren't supported
+    if ((!rgb && !palettized) || buf->info_header.width == 0 || (int32_t) buf->info_header.height <= 0
+        || buf->header.data_offset >= buf->header.file_size)
         return -1;
+
+    if (palettized) {
+        uint32_t colors = buf->info_header.colors_used;
+        if (colors == 0 || colors > BMP_PALETTE_SIZE)
+            colors = BMP_PALETTE_SIZE;
+
+        // the color table follows the info header, which may be bigger than the one read in
+        buf->color_table = (bmp_color_entry_t *) (start + INFO_HEADER_OFFSET + buf->info_header.size);
+        for (uint32_t i = 0; i < colors; i++) {
+            bmp_color_entry_t *entry = buf->color_table + i;
+            buf->palette[i] = (entry->red << 16) | (entry->green << 8) | entry->blue;
+        }
+
+        buf->palette_size = colors;
+        num_read += colors * sizeof(bmp_color_entry_t);
     }
-    
-    buf->color_table = NULL;
-    buf->data = file;
-    num_read += 1;
 
+    buf->data = start + buf->header.data_offset;
     return num_read;
 }
 
@@ -86,15 +119,15 @@ int read_bmp_header(uint8_t *file, bmp_file_header_t *buf) {
 int read_bmp_data(bmp_file_header_t *header, std_stream *in) {
     if (start_pos == NULL) {
         start_pos = header->data;
-        img_size = header->info_header.width * header->info_header.height * header->info_header.bpp;
+        img_size = bmp_data_size(header);
     }
 
-    int num_read = 0;
-    for (int i = 0; i < STD_STREAM_SIZE && header->data - start_pos < (int) img_size; i++) {
-        put_std(in, *header->data);
-        header->data++;
-        num_read++;
-    }
+    int num_read = img_size - (header->data - start_pos);
+    if (num_read > STD_STREAM_SIZE)
+        num_read = STD_STREAM_SIZE;
+    
+    num_read = stream_write(in, (const char *) header->data, num_read);
+    header->data += num_read;
 
     if (num_read < STD_STREAM_SIZE) {
         header->data = start_pos;
@@ -104,7 +137,48 @@ int read_bmp_data(bmp_file_header_t *header, std_stream *in) {
     return num_read;
 }
 
+/** decodes the bmp image pointed to by header into a surface of 32 bit RGB values
+ * the image is only decoded once, later calls return right away
+ * 
+ * @param header: pointer to the bmp_file_header of a previously read in .bmp file
+ * 
+ * @return BMP_SUCC on success, -BMP_UNSUPPORTED if the image wasn't read in correctly
+ * and -BMP_ALLOC_FAIL if there isn't memory for the surface
+ */
+int bmp_decode(bmp_file_header_t *header) {
+    if (header->pixels != NULL)
+        return BMP_SUCC;
+
+    if (header->data == NULL)
+        return -BMP_UNSUPPORTED;
+
+    header->pixels = (uint32_t *) palloc_mult(bmp_surface_pages(header));
+    if (header->pixels == NULL)
+        return -BMP_ALLOC_FAIL;
+
+    if (header->info_header.compression == BMP_RLE8)
+        bmp_decode_rle8(header);
+    else
+        bmp_decode_rows(header);
+
+    return BMP_SUCC;
+}
+
+/** frees the decoded surface of the bmp image pointed to by header
+ * the image is decoded again the next time it's needed
+ * 
+ * @param header: pointer to the bmp_file_header of a previously read in .bmp file
+ */
+void bmp_free(bmp_file_header_t *header) {
+    if (header->pixels == NULL)
+        return;
+
+    pfree_mult(header->pixels, bmp_surface_pages(header));
+    header->pixels = NULL;
+}
+
 /** draws the bmp image pointed to by header at coordinate (x,y)
+ * the image is decoded the first time it's drawn, after that drawing it is a single blit
  *  
  * @param header: pointer to bmp_file_header for previously read in .bmp file
  * @param x: x coordinate to draw the picture starting at the top left of the picture
@@ -112,26 +186,16 @@ int read_bmp_data(bmp_file_header_t *header, std_stream *in) {
  * 
  */
 void draw_bmp_data(bmp_file_header_t *header, uint32_t x, uint32_t y) {
-    uint8_t *pixel = header->data;
-
-    if (header->data == NULL)
+    if (bmp_decode(header) != BMP_SUCC)
         return;
     
-    for (uint32_t i = header->info_header.height; i > 0; i--) {
-        for (uint32_t j = 0; j < header->info_header.width; j++) {
-            uint32_t col = 0;
-            col = *pixel; //blue byte
-            col |= *(pixel + 1) << 8; //green byte
-            col |= *(pixel + 2) << 16;    //red byte
-            vesa_draw(x + j, y + i, col);
-            pixel += 3;
-        }
-
-        pixel += 4 - ((header->info_header.width * (header->info_header.bpp / 8)) % 4);
-    }
+    uint32_t w = header->info_header.width;
+    vesa_blit(header->pixels, w, x, y, w, header->info_header.height);
 }
 
 /** changes color old to color new in the bmp image pointed to by header
+ * palettized images that haven't been decoded yet only have their palette changed,
+ * the embedded file is never modified
  * 
  * @param header: pointer to the bmp_file_header of a previously read in .bmp file
  * @param old: color to replace as a 32 bit RGB value
@@ -139,61 +203,159 @@ void draw_bmp_data(bmp_file_header_t *header, uint32_t x, uint32_t y) {
  * 
  */
 void bmp_change_color(bmp_file_header_t *header, uint32_t old, uint32_t new) {
-    uint8_t *pixel = header->data;
+    if (header->pixels == NULL && header->palette_size > 0) {
+        for (uint32_t i = 0; i < header->palette_size; i++)
+            if (header->palette[i] == old)
+                header->palette[i] = new;
 
-    if (header->data == NULL)
         return;
-    
-    for (uint32_t i = header->info_header.height; i > 0; i--) {
-        for (uint32_t j = 0; j < header->info_header.width; j++) {
-            uint32_t col = 0;
-
-            col = *pixel; //blue byte
-            col |= *(pixel + 1) << 8; //green byte
-            col |= *(pixel + 2) << 16;    //red byte
-
-            if (col == old) {
-                *pixel = new & 0xFF;
-                *(pixel + 1) = new & (0xFF << 8);
-                *(pixel + 2) = new & (0xFF << 16);
-            }
-
-            pixel += 3;
-        }
-
-        pixel += 4 - ((header->info_header.width * (header->info_header.bpp / 8)) % 4);
     }
+
+    if (bmp_decode(header) != BMP_SUCC)
+        return;
+    
+    uint32_t n = header->info_header.width * header->info_header.height;
+    for (uint32_t i = 0; i < n; i++)
+        if (header->pixels[i] == old)
+            header->pixels[i] = new;
 }
 
 /** sets all colors other than color to black in the bmp image pointed to by header
+ * palettized images that haven't been decoded yet only have their palette changed,
+ * the embedded file is never modified
  * 
  * @param header: pointer to the bmp_file_header of a previously read in .bmp file
  * @param color: color to keep in the image as a 32 bit RGB value
  * 
  */
 void bmp_remove_all(bmp_file_header_t *header, uint32_t color) {
-    uint8_t *pixel = header->data;
+    if (header->pixels == NULL && header->palette_size > 0) {
+        for (uint32_t i = 0; i < header->palette_size; i++)
+            if (header->palette[i] != color)
+                header->palette[i] = BLACK;
 
-    if (header->data == NULL)
+        return;
+    }
+
+    if (bmp_decode(header) != BMP_SUCC)
         return;
     
-    for (uint32_t i = header->info_header.height; i > 0; i--) {
-        for (uint32_t j = 0; j < header->info_header.width; j++) {
-            uint32_t col = 0;
+    uint32_t n = header->info_header.width * header->info_header.height;
+    for (uint32_t i = 0; i < n; i++)
+        if (header->pixels[i] != color)
+            header->pixels[i] = BLACK;
+}
+
+/** gets the number of bytes of image data in the bmp image pointed to by header
+ * 
+ * @param header: pointer to the bmp_file_header of a previously read in .bmp file
+ * 
+ * @return number of bytes of image data
+ */
+static uint32_t bmp_data_size(bmp_file_header_t *header) {
+    uint32_t available = header->header.file_size - header->header.data_offset;
+
+    // the image size is allowed to be 0 for uncompressed images
+    if (header->info_header.image_size == 0 || header->info_header.image_size > available)
+        return available;
+
+    return header->info_header.image_size;
+}
 
-            col = *pixel; //blue byte
-            col |= *(pixel + 1) << 8; //green byte
-            col |= *(pixel + 2) << 16;    //red byte
+/** gets the number of pages the decoded surface of the bmp image pointed to by header takes up
+ * 
+ * @param header: pointer to the bmp_file_header of a previously read in .bmp file
+ * 
+ * @return number of pages for the surface
+ */
+static uint32_t bmp_surface_pages(bmp_file_header_t *header) {
+    uint32_t size = header->info_header.width * header->info_header.height * sizeof(uint32_t);
+    return (size + PG_SIZE - 1) / PG_SIZE;
+}
 
-            if (col != color) {
-                *pixel = 0x0;
-                *(pixel + 1) = 0x0;
-                *(pixel + 2) = 0x0;
-            }
+/** decodes an uncompressed 8, 24 or 32-bit image into its surface
+ * rows are stored bottom up and padded to a multiple of 4 bytes
+ * 
+ * @param header: pointer to the bmp_file_header of the image
+ */
+static void bmp_decode_rows(bmp_file_header_t *header) {
+    uint32_t w = header->info_header.width;
+    uint32_t h = header->info_header.height;
+    uint32_t bytes_pp = header->info_header.bpp / 8;
+    uint32_t stride = (w * bytes_pp + 3) & ~3u;
+    uint32_t rows = bmp_data_size(header) / stride;
 
-            pixel += 3;
+    // rows missing from a truncated file are left black
+    if (rows < h)
+        memset32(header->pixels, BLACK, w * (h - rows));
+    else
+        rows = h;
+    
+    for (uint32_t i = 0; i < rows; i++) {
+        const uint8_t *pixel = header->data + i * stride;
+        uint32_t *dest = header->pixels + (h - 1 - i) * w;
+
+        if (bytes_pp == 1) {
+            for (uint32_t j = 0; j < w; j++)
+                dest[j] = header->palette[pixel[j]];
+        } else {
+            for (uint32_t j = 0; j < w; j++, pixel += bytes_pp)
+                dest[j] = (pixel[2] << 16) | (pixel[1] << 8) | pixel[0];
         }
+    }
+}
+
+/** decodes an RLE8 compressed image into its surface
+ * pixels the image skips over are left as the first color of the palette
+ * 
+ * @param header: pointer to the bmp_file_header of the image
+ */
+static void bmp_decode_rle8(bmp_file_header_t *header) {
+    uint32_t w = header->info_header.width;
+    uint32_t h = header->info_header.height;
+    const uint8_t *pos = header->data;
+    const uint8_t *end = pos + bmp_data_size(header);
+    uint32_t x = 0, y = 0;  // y counts up from the bottom row
+
+    memset32(header->pixels, header->palette[0], w * h);
 
-        pixel += 4 - ((header->info_header.width * (header->info_header.bpp / 8)) % 4);
+    while (pos + 2 <= end && y < h) {
+        uint8_t count = pos[0];
+        uint8_t val = pos[1];
+        pos += 2;
+
+        if (count > 0) {
+            // a run of count pixels of color val
+            uint32_t *dest = header->pixels + (h - 1 - y) * w;
+            for (; count > 0 && x < w; count--)
+                dest[x++] = header->palette[val];
+        } else if (val == 0) {
+            // end of line
+            x = 0;
+            y++;
+        } else if (val == 1) {
+            // end of bitmap
+            break;
+        } else if (val == 2) {
+            // move right and up by the next two bytes
+            if (pos + 2 > end)
+                break;
+
+            x += pos[0];
+            y += pos[1];
+            pos += 2;
+        } else {
+            // val literal pixels, padded to a multiple of 2 bytes
+            if (pos + val > end)
+                break;
+
+            uint32_t *dest = header->pixels + (h - 1 - y) * w;
+            for (uint32_t i = 0; i < val; i++)
+                if (x + i < w)
+                    dest[x + i] = header->palette[pos[i]];
+
+            x += val;
+            pos += val + (val & 1);
+        }
     }
 }
\ No newline at end of file
@@ -14,6 +14,13 @@
 #define HEADER_INFO_SIZE sizeof(struct bmp_info_header)
 #define FILE_HEADER_SIZE sizeof(struct bmp_file_header)
 
+#define BMP_SIGNATURE 0x4D42    // "BM"
+#define BMP_PALETTE_SIZE 256    // most colors a palettized image can have
+
+// compression methods
+#define BMP_RGB 0
+#define BMP_RLE8 1
+
 /* structs */
 struct bmp_info_header {
     uint32_t size;
@@ -30,9 +37,9 @@ struct bmp_info_header {
 };
 
 struct bmp_color_table_entry {
-    uint8_t red;
-    uint8_t green;
     uint8_t blue;
+    uint8_t green;
+    uint8_t red;
     uint8_t reserved;
 };
 
@@ -48,6 +55,10 @@ struct __attribute__((__packed__)) bmp_file_header {
     struct bmp_info_header info_header;
     struct bmp_color_table_entry *color_table;
     uint8_t *data;
+
+    uint32_t palette[BMP_PALETTE_SIZE];     // color table as 32 bit RGB values, recolored in place
+    uint32_t palette_size;                  // 0 if the image isn't palettized
+    uint32_t *pixels;                       // image decoded top down as 32 bit RGB values, NULL until it's needed
 };
 
 /* typedefs */
@@ -59,6 +70,8 @@ typedef struct bmp_file_header bmp_file_header_t;
 /* functions */
 int read_bmp_header(uint8_t *file, bmp_file_header_t *buf);
 int read_bmp_data(bmp_file_header_t *header, std_stream *in);
+int bmp_decode(bmp_file_header_t *header);
+void bmp_free(bmp_file_header_t *header);
 void draw_bmp_data(bmp_file_header_t *header, uint32_t x, uint32_t y);
 void print_bmp_header(bmp_file_header_t *header);
 void bmp_change_color(bmp_file_header_t *header, uint32_t old, uint32_t new);
@@ -2,16 +2,25 @@
 
 /* includes */
 #include <stddef.h>
+#include "../kernel/proc.h"
+#include "../kernel/isr.h"
 #include "display.h"
 #include "vesa.h"
+#include "bmp.h"
+#include "timer.h"
 
 /* defines */
+#define DISPLAY_FRAME_TICKS (R_FREQ / DISPLAY_FPS)
+#define CURSOR_BLINK_FRAMES (DISPLAY_FPS / 2)   // frames between cursor blinks
 
 /* globals */
 
 /* prototypes */
 static display_t default_dis;
 static void display_putats(const char *s, uint32_t x, uint32_t y);
+static void display_draw(void *buf, uint32_t x, uint32_t y);
+static uint32_t display_console();
+static void display_refresh(void *aux);
 
 /* functions */
 
@@ -29,14 +38,27 @@ void display_init(void *aux) {
     default_dis.dis_getn_rows = vesa_get_num_rows;
     default_dis.dis_scur = vesa_show_cursor;
     default_dis.dis_hcur = vesa_hide_cursor;
+    default_dis.dis_blink = vesa_blink_cursor;
     default_dis.dis_putc = vesa_print_char;
     default_dis.dis_puts = vesa_print;
+    default_dis.dis_write = vesa_write;
+    default_dis.dis_erase = vesa_erase;
     default_dis.dis_putats = display_putats;
     default_dis.dis_backspace = vesa_print_backspace;
-    default_dis.dis_draw = NULL;    // not implemented
+    default_dis.dis_draw = display_draw;
+    default_dis.dis_fill_rect = vesa_fill_rect;
+    default_dis.dis_blit = vesa_blit;
+    default_dis.dis_copy_rect = vesa_copy_rect;
     default_dis.dis_clear = vesa_clear_screen;
     default_dis.dis_setcol = vesa_set_color;
+    default_dis.dis_setcon = vesa_show_console;
+    default_dis.dis_getcon = vesa_get_shown_console;
+    default_dis.dis_scrollback = vesa_scrollback;
+    default_dis.dis_flush = vesa_flush;
     init_vesa(aux);
+    vesa_set_console_hook(display_console);
+
+    proc_create("display", display_refresh, NULL);
 }
 
 /** utility function for putting a string at location (x,y) on the screen
@@ -50,6 +72,48 @@ static void display_putats(const char *s, uint32_t x, uint32_t y) {
     default_dis.dis_puts(s);
 }
 
+/** utility function for drawing a previously read in .bmp image at location (x,y) on the screen
+ * 
+ * @param buf: pointer to the bmp_file_header of the image
+ * @param x: x coordinate (in pixels) to draw the top left of the image at
+ * @param y: y coordinate (in pixels) to draw the top left of the image at
+ */
+static void display_draw(void *buf, uint32_t x, uint32_t y) {
+    draw_bmp_data((bmp_file_header_t *) buf, x, y);
+}
+
+/** picks the virtual console drawn to by the caller
+ * input is echoed from the keyboard IRQ, so IRQs draw to the console on the screen,
+ * everything else draws to the console of the running process
+ * 
+ * @return number of the caller's console
+ */
+static uint32_t display_console() {
+    if (irq_depth > 0)
+        return vesa_get_shown_console();
+
+    return PROC_CUR()->console;
+}
+
+/** flushes the default display once a frame, so drawing is batched up
+ * into at most DISPLAY_FPS copies to the screen a second
+ * the cursor is blinked every CURSOR_BLINK_FRAMES frames
+ * 
+ * @param aux: unused
+ */
+static void display_refresh(void *aux __attribute__ ((unused))) {
+    uint32_t frame = 0;
+
+    while (1) {
+        thread_block_timeout(DISPLAY_FRAME_TICKS);
+
+        if (++frame % CURSOR_BLINK_FRAMES == 0 && default_dis.dis_blink != NULL)
+            default_dis.dis_blink();
+
+        default_dis.dis_flush();
+    }
+}
+
 /** returns the default display driver initialized by the system 
  * 
  * @return a pointer to the default display driver
@@ -5,8 +5,12 @@
 
 /* includes */
 #include <stdint.h>
+#include <stddef.h>
 
 /* defines */
+#define DISPLAY_FPS 50  // how many times a second the default display is flushed
+#define NUM_CONSOLES 4  // number of virtual consoles, switched between with Alt+F1 to Alt+F4
+#define SCROLLBACK_LINES 2000   // max rows of scrollback kept by each virtual console
 
 /* structs */
 struct display {
@@ -62,6 +66,11 @@ struct display {
     /** hides the cursor from the screen */
     void (*dis_hcur)(void);
 
+    /** switches the cursor between the shown and hidden halves of its blink
+     * called regularly by the display's refresh thread, not garunteed to be implemented
+     */
+    void (*dis_blink)(void);
+
     /** prints a character to the current cursor position
      * 
      * @param c: character to print to the screen
@@ -74,6 +83,24 @@ struct display {
      */
     void (*dis_puts)(const char *s);
 
+    /** prints n characters to the current cursor position as one batch
+     * not garunteed to be implemented
+     * 
+     * @param s: characters to print to the screen
+     * @param n: number of characters to print
+     */
+    void (*dis_write)(const char *s, size_t n);
+
+    /** erases n characters starting at cursor position (x,y), continuing onto the
+     * following rows, the cursor doesn't move
+     * not garunteed to be implemented
+     * 
+     * @param x: x coordinate to start erasing at
+     * @param y: y coordinate to start erasing at
+     * @param n: number of characters to erase
+     */
+    void (*dis_erase)(uint32_t x, uint32_t y, uint32_t n);
+
     /** prints a null-terminated string to the specified cursor position
      * not garunteed to be implemented
      * 
@@ -97,6 +124,41 @@ struct display {
      */
     void (*dis_draw)(void *buf, uint32_t x, uint32_t y);
 
+    /** fills a rectangle of the screen with a color
+     * not garunteed to be implemented
+     * 
+     * @param x: the x coordinate of the top left of the rectangle (in pixels)
+     * @param y: the y coordinate of the top left of the rectangle (in pixels)
+     * @param w: the width of the rectangle (in pixels)
+     * @param h: the height of the rectangle (in pixels)
+     * @param col: the color to fill with
+     */
+    void (*dis_fill_rect)(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t col);
+
+    /** copies a rectangle of pixels to the screen
+     * not garunteed to be implemented
+     * 
+     * @param src: the pixels to copy, row by row
+     * @param stride: the number of pixels from the start of one row of src to the next
+     * @param x: the x coordinate of the top left of the rectangle (in pixels)
+     * @param y: the y coordinate of the top left of the rectangle (in pixels)
+     * @param w: the width of the rectangle (in pixels)
+     * @param h: the height of the rectangle (in pixels)
+     */
+    void (*dis_blit)(const uint32_t *src, uint32_t stride, uint32_t x, uint32_t y, uint32_t w, uint32_t h);
+
+    /** copies a rectangle of the screen to another place on the screen, the two may overlap
+     * not garunteed to be implemented
+     * 
+     * @param src_x: the x coordinate of the top left of the rectangle to copy (in pixels)
+     * @param src_y: the y coordinate of the top left of the rectangle to copy (in pixels)
+     * @param w: the width of the rectangle (in pixels)
+     * @param h: the height of the rectangle (in pixels)
+     * @param dest_x: the x coordinate to copy the rectangle to (in pixels)
+     * @param dest_y: the y coordinate to copy the rectangle to (in pixels)
+     */
+    void (*dis_copy_rect)(uint32_t src_x, uint32_t src_y, uint32_t w, uint32_t h, uint32_t dest_x, uint32_t dest_y);
+
     /** clears the screen */
     void (*dis_clear)(void);
 
@@ -107,6 +169,32 @@ struct display {
      * @param bg: the color of the background
      */
     void (*dis_setcol)(uint32_t fg, uint32_t bg);
+
+    /** shows a virtual console on the screen
+     * not garunteed to be implemented
+     * 
+     * @param n: the number of the console to show, less than NUM_CONSOLES
+     */
+    void (*dis_setcon)(uint32_t n);
+
+    /** scrolls the view of the caller's console through its scrollback
+     * not garunteed to be implemented
+     * 
+     * @param rows: number of rows to scroll back, negative to scroll forward towards the live screen
+     */
+    void (*dis_scrollback)(int32_t rows);
+
+    /** gets the virtual console shown on the screen
+     * not garunteed to be implemented
+     * 
+     * @return the number of the console shown
+     */
+    uint32_t (*dis_getcon)(void);
+
+    /** copies everything drawn since the last flush to the screen
+     * drivers that draw straight to the screen can leave this NULL
+     */
+    void (*dis_flush)(void);
 };
 
 /* typedefs */
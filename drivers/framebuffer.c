@@ -0,0 +1,236 @@
+/* Implements the framebuffer abstraction. 16, 24 and 32 bit RGB framebuffers with any pitch and
+ * channel positions are supported. The row writers are specialized per pixel format and picked
+ * once in fb_init, so drawing never branches on the format per pixel. */
+
+/* includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <mem.h>
+#include <kerrors.h>
+#include "../boot/multiboot.h"
+#include "framebuffer.h"
+
+/* defines */
+#define RGB_RED(c) (((c) >> 16) & 0xff)
+#define RGB_GREEN(c) (((c) >> 8) & 0xff)
+#define RGB_BLUE(c) ((c) & 0xff)
+
+/* prototypes */
+static bool fb_channel_valid(struct fb_channel *ch, uint8_t bpp);
+static void fb_write_row_native(framebuffer_t *fb, uint8_t *dest, const uint32_t *src, size_t n);
+static void fb_write_row_32(framebuffer_t *fb, uint8_t *dest, const uint32_t *src, size_t n);
+static void fb_write_row_24(framebuffer_t *fb, uint8_t *dest, const uint32_t *src, size_t n);
+static void fb_write_row_16(framebuffer_t *fb, uint8_t *dest, const uint32_t *src, size_t n);
+static void fb_fill_row_32(uint8_t *dest, uint32_t px, size_t n);
+static void fb_fill_row_24(uint8_t *dest, uint32_t px, size_t n);
+static void fb_fill_row_16(uint8_t *dest, uint32_t px, size_t n);
+
+/* functions */
+
+/** initializes a framebuffer from the video info in the mbi
+ * 
+ * @param fb: framebuffer to initialize
+ * @param mbi: pointer to the mbi given by GRUB2
+ * 
+ * @return FB_SUCC on success, -FB_UNSUPPORTED if the framebuffer isn't 16, 24 or 32 bit RGB
+ */
+int fb_init(framebuffer_t *fb, multiboot_info_t *mbi) {
+    if (mbi->framebuffer_type != MULTIBOOT_FRAMEBUFFER_TYPE_RGB)
+        return -FB_UNSUPPORTED;
+
+    fb->addr = (uint8_t *) ((uint32_t) mbi->framebuffer_addr);
+    fb->width = mbi->framebuffer_width;
+    fb->height = mbi->framebuffer_height;
+    fb->pitch = mbi->framebuffer_pitch;
+    fb->bpp = mbi->framebuffer_bpp;
+
+    fb->red.pos = mbi->framebuffer_red_field_position;
+    fb->red.size = mbi->framebuffer_red_mask_size;
+    fb->green.pos = mbi->framebuffer_green_field_position;
+    fb->green.size = mbi->framebuffer_green_mask_size;
+    fb->blue.pos = mbi->framebuffer_blue_field_position;
+    fb->blue.size = mbi->framebuffer_blue_mask_size;
+
+    if (!fb_channel_valid(&fb->red, fb->bpp) || !fb_channel_valid(&fb->green, fb->bpp)
+                                             || !fb_channel_valid(&fb->blue, fb->bpp))
+        return -FB_UNSUPPORTED;
+
+    fb->native = false;
+    switch (fb->bpp) {
+        case 32:
+            fb->native = fb->red.pos == 16 && fb->green.pos == 8 && fb->blue.pos == 0 &&
+                         fb->red.size == 8 && fb->green.size == 8 && fb->blue.size == 8;
+            fb->write_row = fb->native ? fb_write_row_native : fb_write_row_32;
+            fb->fill_row = fb_fill_row_32;
+            break;
+        case 24:
+            fb->write_row = fb_write_row_24;
+            fb->fill_row = fb_fill_row_24;
+            break;
+        case 16:
+            fb->write_row = fb_write_row_16;
+            fb->fill_row = fb_fill_row_16;
+            break;
+        default:
+            return -FB_UNSUPPORTED;
+    }
+
+    fb->bytes_pp = fb->bpp / 8;
+
+    if (fb->pitch < fb->width * fb->bytes_pp)
+        return -FB_UNSUPPORTED;
+
+    return FB_SUCC;
+}
+
+/** converts a 32 bit RGB color to a pixel of the framebuffer's format
+ * 
+ * @param fb: framebuffer to convert for
+ * @param rgb: color to convert
+ * 
+ * @return pixel in the framebuffer's format, in the low bytes_pp bytes
+ */
+uint32_t fb_pack(framebuffer_t *fb, uint32_t rgb) {
+    return ((RGB_RED(rgb) >> (FB_CHANNEL_BITS - fb->red.size)) << fb->red.pos) |
+           ((RGB_GREEN(rgb) >> (FB_CHANNEL_BITS - fb->green.size)) << fb->green.pos) |
+           ((RGB_BLUE(rgb) >> (FB_CHANNEL_BITS - fb->blue.size)) << fb->blue.pos);
+}
+
+/** writes n 32 bit RGB pixels to the framebuffer starting at (x, y)
+ * 
+ * @param fb: framebuffer to write to
+ * @param x: x coordinate to start at
+ * @param y: y coordinate of the row to write to
+ * @param src: pixels to write, must not run past the end of the row
+ * @param n: number of pixels to write
+ */
+void fb_write(framebuffer_t *fb, uint32_t x, uint32_t y, const uint32_t *src, size_t n) {
+    fb->write_row(fb, fb->addr + (y * fb->pitch) + (x * fb->bytes_pp), src, n);
+}
+
+/** fills a rectangle of the framebuffer with one color
+ * 
+ * @param fb: framebuffer to fill
+ * @param x: x coordinate of the rectangle
+ * @param y: y coordinate of the rectangle
+ * @param w: width of the rectangle
+ * @param h: height of the rectangle
+ * @param rgb: color to fill with as a 32 bit RGB value
+ */
+void fb_fill_rect(framebuffer_t *fb, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t rgb) {
+    uint32_t px = fb_pack(fb, rgb);
+    uint8_t *dest = fb->addr + (y * fb->pitch) + (x * fb->bytes_pp);
+
+    for (uint32_t i = 0; i < h; i++) {
+        fb->fill_row(dest, px, w);
+        dest += fb->pitch;
+    }
+}
+
+/* static functions */
+
+/** checks that a channel fits in a pixel and has at most FB_CHANNEL_BITS bits
+ * 
+ * @param ch: channel to check
+ * @param bpp: bits per pixel of the framebuffer
+ * 
+ * @return true if the channel can be converted to, false otherwise
+ */
+static bool fb_channel_valid(struct fb_channel *ch, uint8_t bpp) {
+    return ch->size > 0 && ch->size <= FB_CHANNEL_BITS && ch->pos + ch->size <= bpp;
+}
+
+/** writes a row of pixels to a framebuffer with the same layout as 32 bit RGB
+ * 
+ * @param fb: unused
+ * @param dest: address in the framebuffer to write to
+ * @param src: pixels to write
+ * @param n: number of pixels to write
+ */
+static void fb_write_row_native(framebuffer_t *fb __attribute__ ((unused)), uint8_t *dest, const uint32_t *src, size_t n) {
+    memcpy(dest, src, n * sizeof(uint32_t));
+}
+
+/** writes a row of pixels to a 32 bit framebuffer with other channel positions
+ * 
+ * @param fb: framebuffer written to
+ * @param dest: address in the framebuffer to write to
+ * @param src: pixels to write
+ * @param n: number of pixels to write
+ */
+static void fb_write_row_32(framebuffer_t *fb, uint8_t *dest, const uint32_t *src, size_t n) {
+    uint32_t *d = (uint32_t *) dest;
+
+    for (size_t i = 0; i < n; i++)
+        d[i] = fb_pack(fb, src[i]);
+}
+
+/** writes a row of pixels to a 24 bit framebuffer
+ * 
+ * @param fb: framebuffer written to
+ * @param dest: address in the framebuffer to write to
+ * @param src: pixels to write
+ * @param n: number of pixels to write
+ */
+static void fb_write_row_24(framebuffer_t *fb, uint8_t *dest, const uint32_t *src, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        uint32_t px = fb_pack(fb, src[i]);
+        dest[0] = px;
+        dest[1] = px >> 8;
+        dest[2] = px >> 16;
+        dest += 3;
+    }
+}
+
+/** writes a row of pixels to a 16 bit framebuffer
+ * 
+ * @param fb: framebuffer written to
+ * @param dest: address in the framebuffer to write to
+ * @param src: pixels to write
+ * @param n: number of pixels to write
+ */
+static void fb_write_row_16(framebuffer_t *fb, uint8_t *dest, const uint32_t *src, size_t n) {
+    uint16_t *d = (uint16_t *) dest;
+
+    for (size_t i = 0; i < n; i++)
+        d[i] = fb_pack(fb, src[i]);
+}
+
+/** fills a row of a 32 bit framebuffer
+ * 
+ * @param dest: address in the framebuffer to write to
+ * @param px: pixel to write, already converted with fb_pack
+ * @param n: number of pixels to write
+ */
+static void fb_fill_row_32(uint8_t *dest, uint32_t px, size_t n) {
+    memset32(dest, px, n);
+}
+
+/** fills a row of a 24 bit framebuffer
+ * 
+ * @param dest: address in the framebuffer to write to
+ * @param px: pixel to write, already converted with fb_pack
+ * @param n: number of pixels to write
+ */
+static void fb_fill_row_24(uint8_t *dest, uint32_t px, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        dest[0] = px;
+        dest[1] = px >> 8;
+        dest[2] = px >> 16;
+        dest += 3;
+    }
+}
+
+/** fills a row of a 16 bit framebuffer
+ * 
+ * @param dest: address in the framebuffer to write to
+ * @param px: pixel to write, already converted with fb_pack
+ * @param n: number of pixels to write
+ */
+static void fb_fill_row_16(uint8_t *dest, uint32_t px, size_t n) {
+    uint16_t *d = (uint16_t *) dest;
+
+    for (size_t i = 0; i < n; i++)
+        d[i] = px;
+}
@@ -0,0 +1,61 @@
+/* Defines the framebuffer abstraction used by the display drivers. A framebuffer describes
+ * the layout of video memory given by GRUB2 and converts 32 bit RGB pixels to it. */
+#ifndef _FRAMEBUFFER_H
+#define _FRAMEBUFFER_H
+
+/* includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../boot/multiboot.h"
+
+/* defines */
+#define FB_CHANNEL_BITS 8   // bits per channel of the 32 bit RGB pixels that are converted
+
+/* structs */
+
+/* position and size in bits of a color channel in a framebuffer pixel */
+struct fb_channel {
+    uint8_t pos;
+    uint8_t size;
+};
+
+struct framebuffer {
+    uint8_t *addr;
+    uint32_t width, height;
+    uint32_t pitch;             // bytes per row, can be more than width * bytes_pp
+    uint8_t bpp;
+    uint8_t bytes_pp;
+    struct fb_channel red, green, blue;
+    bool native;                // pixels are laid out like 32 bit RGB, so rows can be copied as is
+
+    /** converts n 32 bit RGB pixels and writes them to dest
+     * chosen for the pixel format by fb_init
+     * 
+     * @param fb: framebuffer written to
+     * @param dest: address in the framebuffer to write to
+     * @param src: pixels to write
+     * @param n: number of pixels to write
+     */
+    void (*write_row)(struct framebuffer *fb, uint8_t *dest, const uint32_t *src, size_t n);
+
+    /** writes n pixels of the same color to dest
+     * chosen for the pixel format by fb_init
+     * 
+     * @param dest: address in the framebuffer to write to
+     * @param px: pixel to write, already converted with fb_pack
+     * @param n: number of pixels to write
+     */
+    void (*fill_row)(uint8_t *dest, uint32_t px, size_t n);
+};
+
+/* typedefs */
+typedef struct framebuffer framebuffer_t;
+
+/* functions */
+int fb_init(framebuffer_t *fb, multiboot_info_t *mbi);
+uint32_t fb_pack(framebuffer_t *fb, uint32_t rgb);
+void fb_write(framebuffer_t *fb, uint32_t x, uint32_t y, const uint32_t *src, size_t n);
+void fb_fill_rect(framebuffer_t *fb, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t rgb);
+
+#endif
@@ -11,19 +11,27 @@
 /* defines */
 
 /* globals */
-static term_t *out_term = NULL;
+static bool extended = false;   // the last scancode was SC_EXTENDED
 
 /* functions */
 
 /** keyboard interrupt handler
- * writes characters pressed to the screen 
+ * writes characters pressed to the terminal of the console on the screen
  * 
  * @param r: unused
  */
 static void keyboard_handler(struct register_frame *r __attribute__ ((unused))) {
     uint8_t scancode = inb(0x60);
+    term_t *out_term = get_default_terminal();
     if (out_term == NULL)
-        out_term = get_default_terminal();
+        return;
+
+    // extended keys like PgUp are wrapped in fake shift presses and releases, which are dropped
+    // so Shift+PgUp still has shift held
+    bool was_extended = extended;
+    extended = scancode == SC_EXTENDED;
+    if (was_extended && (scancode == SC_LSHIFT || scancode == SC_LSHIFT_REL))
+        return;
 
     //#ifdef SCANCODE_SET1
     if (scancode == SC_LALT_REL || scancode == SC_LSHIFT_REL || scancode == SC_LCTRL_REL 
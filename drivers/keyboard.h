@@ -23,6 +23,10 @@
 #define SC_LSHIFT_REL 0xAA
 #define SC_LCTRL_REL 0x9D
 #define SC_RSHIFT_REL 0xB6
+#define SC_F1 0x3B  // F1 to F10 are consecutive
+#define SC_PGUP 0x49
+#define SC_PGDN 0x51
+#define SC_EXTENDED 0xE0  // prefix of the scancodes of extended keys
 #endif
 
 #ifdef SCAN_CODE_SET2
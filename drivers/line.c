@@ -13,7 +13,7 @@
 /* defines */
 
 /* globals */
-static struct line_discipline dline;
+static struct line_discipline lines[NUM_CONSOLES];     // line discipline of each virtual console
 
 const char kc_ascii[] = { '?', '?', '1', '2', '3', '4', '5', '6',     
                           '7', '8', '9', '0', '-', '=', '?', '?', 
@@ -119,6 +119,10 @@ static int line_in(line_disc_t *ld, char c) {
     // update terminal state
     char kc_ret = eval_kc(ld->term, c);
 
+    // typing returns the view to the live screen
+    if (kc_ret != 0 && ld->term->dis->dis_scrollback != NULL)
+        ld->term->dis->dis_scrollback(-SCROLLBACK_LINES);
+
     if (ld->buffer_i == LINE_BUFFER_SIZE - 1)
         return -LINE_IN_FAIL;
     
@@ -161,8 +165,10 @@ static int line_in(line_disc_t *ld, char c) {
  * @return number of chars written
  */
 static size_t line_ins(line_disc_t *ld, char *s) {
+    size_t len = strlen(s);
+
     size_t i;
-    for (i = 0; i < strlen(s) && i < LINE_BUFFER_SIZE; i++)
+    for (i = 0; i < len && i < LINE_BUFFER_SIZE; i++)
         if (line_in(ld, s[i]) == -LINE_IN_FAIL)
             return i;
     
@@ -201,12 +207,15 @@ static size_t line_out(line_disc_t *ld) {
  * @return number of characters written
  */
 static size_t line_send(line_disc_t *ld) {
-    size_t i;
-    for (i = 0; i < ld->buffer_i && i < LINE_BUFFER_SIZE && ld->line_buffer[i] != 0; i++)
-        put_std(ld->out, ld->line_buffer[i]);
+    size_t n = ld->buffer_i < LINE_BUFFER_SIZE ? ld->buffer_i : LINE_BUFFER_SIZE;
+    const char *end = memchr(ld->line_buffer, '\0', n);
+    if (end != NULL)
+        n = end - ld->line_buffer;
+    
+    stream_write(ld->out, ld->line_buffer, n);
 
     ld->buffer_i = 0;
-    return i;
+    return n;
 }
 
 /** send a char from the line_buffer to the connected process
@@ -296,7 +305,8 @@ static int line_outbufn(line_disc_t *ld, char *buf, uint32_t n) {
  */
 static size_t line_recs(line_disc_t *ld, char *s) {
     // calculate amount of buffer left
-    size_t s_size = strlen(s) < LINE_BUFFER_SIZE - ld->buffer_i  ? strlen(s) : LINE_BUFFER_SIZE - ld->buffer_i + 1;
+    size_t len = strlen(s);
+    size_t s_size = len < LINE_BUFFER_SIZE - ld->buffer_i  ? len : LINE_BUFFER_SIZE - ld->buffer_i + 1;
     // copy string
     memcpy(ld->line_buffer + ld->buffer_i, s, s_size);
     // update buffer
@@ -305,16 +315,31 @@ static size_t line_recs(line_disc_t *ld, char *s) {
     return s_size;
 }
 
-/** returns the default line discipline
+/** returns the default line discipline, the line discipline of the first console
  * 
  * @return pointer to the default line discipline
  */
 line_disc_t *get_default_line_disc() {
-    return &dline;
+    return lines;
+}
+
+/** returns the line discipline of a virtual console
+ * 
+ * @param console: number of the console
+ * 
+ * @return pointer to the console's line discipline, NULL if the console doesn't exist
+ */
+line_disc_t *get_line_disc(uint32_t console) {
+    if (console >= NUM_CONSOLES)
+        return NULL;
+
+    return lines + console;
 }
 
 /** utility function that checks if a given keycode is whitespace
- * also updates the state of the specified terminal in some cases
+ * also updates the state of the specified terminal in some cases,
+ * switches to console n when Alt+F(n+1) is pressed,
+ * and pages through the scrollback when Shift+PgUp/PgDn is pressed
  * 
  * @param t: terminal to get the state from
  * @param keycode: keycode to evaluate
@@ -329,13 +354,25 @@ static char eval_kc(term_t *t, unsigned char keycode) {
     
     switch (keycode) {
         case KC_LALT:
-            ts->alt_pressed = !ts->alt_pressed;
+            ts->alt_pressed = true;
+            return 0;
+        case KC_LALT_REL:
+            ts->alt_pressed = false;
             return 0;
         case KC_LSHIFT:
         case KC_RSHIFT:
         case KC_LSHIFT_REL:
         case KC_RSHIFT_REL:
             ts->capitalize = !ts->capitalize;
+            ts->shift_pressed = keycode == KC_LSHIFT || keycode == KC_RSHIFT;
+            return 0;
+        case KC_PGUP:
+        case KC_PGDN:
+            if (ts->shift_pressed && t->dis->dis_scrollback != NULL && t->dis->dis_getn_rows != NULL) {
+                int32_t page = t->dis->dis_getn_rows();
+                t->dis->dis_scrollback(keycode == KC_PGUP ? page : -page);
+            }
+
             return 0;
         case KC_CAPSLOCK:
             ts->capitalize = !ts->capitalize;
@@ -349,6 +386,13 @@ static char eval_kc(term_t *t, unsigned char keycode) {
         case KC_RELEASED:
             return 0;
         default:
+            if (keycode >= KC_F1 && keycode < KC_F1 + NUM_CONSOLES) {
+                if (ts->alt_pressed)
+                    terminal_switch(keycode - KC_F1);
+                
+                return 0;
+            }
+
             if (keycode <= KC_MAX)
                 return keycode;
             else
@@ -138,4 +138,5 @@ typedef enum ld_modes ld_modes_t;
 /* functions */
 int line_init(line_disc_t *ld, struct terminal *t, std_stream *in, std_stream *out, ld_modes_t m);
 line_disc_t *get_default_line_disc();
+line_disc_t *get_line_disc(uint32_t console);
 #endif
\ No newline at end of file
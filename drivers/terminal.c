@@ -1,4 +1,6 @@
-/* Default implementation of the terminal interface with some extra functionality */
+/* Default implementation of the terminal interface with some extra functionality. Output is run
+ * through a VT100 escape sequence parser, which supports cursor movement (ESC[A-D, G, H, f, s, u),
+ * erasing the line or screen (ESC[K, J), SGR colors (ESC[m) and showing/hiding the cursor (ESC[?25h/l). */
 
 /* includes */
 #include <stdio.h>
@@ -10,13 +12,30 @@
 #include "terminal.h"
 
 /* defines */
+#define TERM_DEFAULT_FG 0xFFFFFF
+#define TERM_DEFAULT_BG 0x000000
+#define TERM_NUM_COLORS 16
 
 /* globals */
 static term_t *dterm = NULL;
+static term_t *console_terms[NUM_CONSOLES];     // terminal attached to each virtual console
+static uint32_t fg_console = 0;                 // console shown on the screen, which gets keyboard input
+
+// colors of the SGR color indices, 0-7 are the normal colors and 8-15 their bright versions
+static const uint32_t term_colors[TERM_NUM_COLORS] = {
+    0x000000, 0xAA0000, 0x00AA00, 0xAA5500, 0x0000AA, 0xAA00AA, 0x00AAAA, 0xAAAAAA,
+    0x555555, 0xFF5555, 0x55FF55, 0xFFFF55, 0x5555FF, 0xFF55FF, 0x55FFFF, 0xFFFFFF
+};
 
 /* prototypes */
 static int terminal_write(term_t *t, char c);
 static int terminal_writes(term_t *t, char *s);
+static int terminal_writen(term_t *t, const char *s, size_t n);
+static void terminal_draw(term_t *t, const char *s, size_t n);
+static void terminal_escape(term_t *t, char c);
+static void terminal_csi(term_t *t, char cmd);
+static void terminal_sgr(term_t *t);
+static uint32_t terminal_color(uint8_t idx, bool bright, uint32_t def);
 static int terminal_in(term_t *t, char c);
 static int terminal_ins(term_t *t, char *s);
 
@@ -37,6 +56,14 @@ int terminal_init(term_t *t, line_disc_t *ld, struct display *dd) {
     t->ts.capitalize = false;
     t->ts.alt_pressed = false;
     t->ts.ctrl_pressed = false;
+    t->ts.shift_pressed = false;
+
+    t->vt.state = ESC_NONE;
+    t->vt.num_params = 0;
+    t->vt.private = false;
+    t->vt.fg = t->vt.bg = TERM_DEFAULT_COLOR;
+    t->vt.bold = false;
+    t->vt.saved_x = t->vt.saved_y = 0;
 
     if (dd == NULL)
         t->dis = get_default_dis_driver();
@@ -48,6 +75,7 @@ int terminal_init(term_t *t, line_disc_t *ld, struct display *dd) {
     t->term_init = NULL;
     t->term_write = terminal_write;
     t->term_writes = terminal_writes;
+    t->term_writen = terminal_writen;
     t->term_in = terminal_in;
     t->term_ins = terminal_ins;
 
@@ -57,6 +85,42 @@ int terminal_init(term_t *t, line_disc_t *ld, struct display *dd) {
     return TERM_SUCC;
 }
 
+/** attaches a terminal to a virtual console
+ * the terminal attached to the console on the screen gets the keyboard input
+ * 
+ * @param t: terminal to attach, must be non-NULL
+ * @param console: number of the console to attach t to
+ * 
+ * @return -TERM_INIT_FAIL if console doesn't exist, TERM_SUCC otherwise
+ */
+int terminal_attach(term_t *t, uint32_t console) {
+    if (t == NULL || console >= NUM_CONSOLES)
+        return -TERM_INIT_FAIL;
+
+    console_terms[console] = t;
+    return TERM_SUCC;
+}
+
+/** switches the screen and keyboard to a virtual console
+ * modifier keys that are held down stay held down on the new console
+ * 
+ * @param console: number of the console to switch to, nothing happens if no terminal is attached to it
+ */
+void terminal_switch(uint32_t console) {
+    if (console >= NUM_CONSOLES || console == fg_console || console_terms[console] == NULL)
+        return;
+
+    term_t *from = get_default_terminal();
+    term_t *to = console_terms[console];
+
+    if (from != NULL)
+        to->ts = from->ts;
+    
+    fg_console = console;
+    if (to->dis->dis_setcon != NULL)
+        to->dis->dis_setcon(console);
+}
+
 /** writes the given ASCII character to the screen 
  * 
  * @param t: terminal to write to
@@ -65,7 +129,7 @@ int terminal_init(term_t *t, line_disc_t *ld, struct display *dd) {
  * @return TERM_SUCC
  */
 static int terminal_write(term_t *t, char c) {
-    t->dis->dis_putc(c);
+    terminal_writen(t, &c, 1);
     return TERM_SUCC;
 }
 
@@ -77,10 +141,253 @@ static int terminal_write(term_t *t, char c) {
  * @return TERM_SUCC
  */
 static int terminal_writes(term_t *t, char *s) {
-    t->dis->dis_puts(s);
+    terminal_writen(t, s, strlen(s));
     return TERM_SUCC;
 }
 
+/** writes n ASCII characters to the screen, interpreting escape sequences
+ * the text between escape sequences is drawn with one call to the display driver
+ * 
+ * @param t: terminal to write to
+ * @param s: characters to write to screen
+ * @param n: number of characters to write
+ * 
+ * @return number of characters written
+ */
+static int terminal_writen(term_t *t, const char *s, size_t n) {
+    size_t start = 0;   // start of the text that hasn't been drawn yet
+
+    for (size_t i = 0; i < n; i++) {
+        if (t->vt.state == ESC_NONE && s[i] != ASCII_ESCAPE)
+            continue;
+        
+        terminal_draw(t, s + start, i - start);
+        terminal_escape(t, s[i]);
+        start = i + 1;
+    }
+
+    terminal_draw(t, s + start, n - start);
+    return n;
+}
+
+/** draws n characters of plain text to the screen
+ * 
+ * @param t: terminal to draw with
+ * @param s: characters to draw
+ * @param n: number of characters to draw
+ */
+static void terminal_draw(term_t *t, const char *s, size_t n) {
+    if (n == 0)
+        return;
+    
+    if (t->dis->dis_write != NULL) {
+        t->dis->dis_write(s, n);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++)
+        t->dis->dis_putc(s[i]);
+}
+
+/** feeds a character of an escape sequence to the parser, running the sequence once it's complete
+ * only CSI sequences (ESC[) are supported, others are dropped
+ * 
+ * @param t: terminal the sequence was written to
+ * @param c: next character of the sequence
+ */
+static void terminal_escape(term_t *t, char c) {
+    struct terminal_vt *vt = &t->vt;
+
+    switch (vt->state) {
+        case ESC_NONE:
+            vt->state = ESC_START;
+            break;
+        case ESC_START:
+            vt->state = c == '[' ? ESC_CSI : ESC_NONE;
+            vt->num_params = 0;
+            vt->params[0] = 0;
+            vt->private = false;
+            break;
+        case ESC_CSI:
+            if (c >= '0' && c <= '9') {
+                if (vt->num_params == 0)
+                    vt->num_params = 1;
+                
+                uint32_t *p = &vt->params[vt->num_params - 1];
+                if (*p < UINT16_MAX)
+                    *p = *p * 10 + (c - '0');
+            } else if (c == ';') {
+                if (vt->num_params == 0)
+                    vt->num_params = 1;
+
+                if (vt->num_params < TERM_ESC_MAX_PARAMS)
+                    vt->params[vt->num_params++] = 0;
+            } else if (c == '?') {
+                vt->private = true;
+            } else if (c >= '@' && c <= '~') {
+                // final byte of the sequence
+                vt->state = ESC_NONE;
+                terminal_csi(t, c);
+            } else if (c < ' ' || c > '/') {
+                // not an intermediate byte, so the sequence is malformed
+                vt->state = ESC_NONE;
+            }
+            break;
+    }
+}
+
+/** runs a complete CSI sequence
+ * 
+ * @param t: terminal the sequence was written to
+ * @param cmd: final character of the sequence
+ */
+static void terminal_csi(term_t *t, char cmd) {
+    struct terminal_vt *vt = &t->vt;
+    display_t *dis = t->dis;
+
+    if (cmd == 'm') {
+        terminal_sgr(t);
+        return;
+    }
+
+    if (dis->dis_setcur == NULL || dis->dis_getn_cols == NULL || dis->dis_getn_rows == NULL)
+        return;
+
+    uint32_t p0 = vt->num_params > 0 ? vt->params[0] : 0;
+    uint32_t p1 = vt->num_params > 1 ? vt->params[1] : 0;
+    uint32_t n = p0 > 0 ? p0 : 1;   // counts and positions default to 1
+    uint32_t x = dis->dis_getx();
+    uint32_t y = dis->dis_gety();
+    uint32_t cols = dis->dis_getn_cols();
+    uint32_t rows = dis->dis_getn_rows();
+
+    switch (cmd) {
+        case 'A':
+            y = n > y ? 0 : y - n;
+            break;
+        case 'B':
+            y = y + n < rows ? y + n : rows - 1;
+            break;
+        case 'C':
+            x = x + n < cols ? x + n : cols - 1;
+            break;
+        case 'D':
+            x = n > x ? 0 : x - n;
+            break;
+        case 'G':
+            x = n <= cols ? n - 1 : cols - 1;
+            break;
+        case 'H':
+        case 'f':
+            y = n <= rows ? n - 1 : rows - 1;
+            x = p1 == 0 ? 0 : (p1 <= cols ? p1 - 1 : cols - 1);
+            break;
+        case 'J':
+            if (dis->dis_erase == NULL)
+                break;
+            
+            if (p0 == 0)
+                dis->dis_erase(x, y, (rows - y) * cols - x);
+            else if (p0 == 1)
+                dis->dis_erase(0, 0, y * cols + x + 1);
+            else if (p0 == 2)
+                dis->dis_erase(0, 0, rows * cols);
+            break;
+        case 'K':
+            if (dis->dis_erase == NULL)
+                break;
+            
+            if (p0 == 0)
+                dis->dis_erase(x, y, x < cols ? cols - x : 0);
+            else if (p0 == 1)
+                dis->dis_erase(0, y, x + 1);
+            else if (p0 == 2)
+                dis->dis_erase(0, y, cols);
+            break;
+        case 's':
+            vt->saved_x = x;
+            vt->saved_y = y;
+            break;
+        case 'u':
+            x = vt->saved_x;
+            y = vt->saved_y;
+            break;
+        case 'h':
+            if (vt->private && p0 == 25 && dis->dis_scur != NULL)
+                dis->dis_scur();
+            break;
+        case 'l':
+            if (vt->private && p0 == 25 && dis->dis_hcur != NULL)
+                dis->dis_hcur();
+            break;
+        default:
+            break;
+    }
+
+    dis->dis_setcur(x, y);
+}
+
+/** runs an SGR (ESC[m) sequence, which sets the colors text is drawn in
+ * 
+ * @param t: terminal the sequence was written to
+ */
+static void terminal_sgr(term_t *t) {
+    struct terminal_vt *vt = &t->vt;
+
+    // no parameters is the same as a reset
+    if (vt->num_params == 0) {
+        vt->num_params = 1;
+        vt->params[0] = 0;
+    }
+
+    for (uint32_t i = 0; i < vt->num_params; i++) {
+        uint32_t p = vt->params[i];
+
+        if (p == 0) {
+            vt->fg = vt->bg = TERM_DEFAULT_COLOR;
+            vt->bold = false;
+        } else if (p == 1) {
+            vt->bold = true;
+        } else if (p == 22) {
+            vt->bold = false;
+        } else if (p >= 30 && p <= 37) {
+            vt->fg = p - 30;
+        } else if (p == 39) {
+            vt->fg = TERM_DEFAULT_COLOR;
+        } else if (p >= 40 && p <= 47) {
+            vt->bg = p - 40;
+        } else if (p == 49) {
+            vt->bg = TERM_DEFAULT_COLOR;
+        } else if (p >= 90 && p <= 97) {
+            vt->fg = p - 90 + 8;
+        } else if (p >= 100 && p <= 107) {
+            vt->bg = p - 100 + 8;
+        }
+    }
+
+    if (t->dis->dis_setcol != NULL)
+        t->dis->dis_setcol(terminal_color(vt->fg, vt->bold, TERM_DEFAULT_FG),
+                           terminal_color(vt->bg, false, TERM_DEFAULT_BG));
+}
+
+/** gets the color of an SGR color index
+ * 
+ * @param idx: color index, TERM_DEFAULT_COLOR for the default color
+ * @param bright: whether to use the bright version of colors 0-7
+ * @param def: default color
+ * 
+ * @return color as a 32 bit RGB value
+ */
+static uint32_t terminal_color(uint8_t idx, bool bright, uint32_t def) {
+    if (idx >= TERM_NUM_COLORS)
+        return def;
+    
+    if (bright && idx < 8)
+        idx += 8;
+
+    return term_colors[idx];
+}
+
 /** outputs the given keycode to the line discipline 
  * 
  * @param t: terminal to write from
@@ -109,10 +416,27 @@ static int terminal_ins(term_t *t, char *s) {
     return i;
 }
 
-/** gets the terminal connected to default line discipline
+/** gets the terminal attached to the console on the screen, or the first terminal
+ * made if none are attached to it
  * 
  * @return a pointer to the default terminal
  */
 term_t *get_default_terminal() {
+    if (console_terms[fg_console] != NULL)
+        return console_terms[fg_console];
+
     return dterm;
+}
+
+/** gets the terminal attached to a virtual console
+ * 
+ * @param console: number of the console
+ * 
+ * @return a pointer to the console's terminal, NULL if none is attached to it
+ */
+term_t *get_console_terminal(uint32_t console) {
+    if (console >= NUM_CONSOLES)
+        return NULL;
+
+    return console_terms[console];
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 /* includes */
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "keyboard.h"
 #include "display.h"
 #include "line.h"
@@ -13,6 +14,8 @@
 #define TERMINAL_BUFF_SIZE 1023
 #define TERMINAL_BUFF_TYPE char
 #define TAB_WIDTH 4
+#define TERM_ESC_MAX_PARAMS 8       // most parameters an escape sequence keeps, the rest are dropped
+#define TERM_DEFAULT_COLOR 0xFF     // color index of the default foreground/background color
 
 #define KC_MAX 57
 #define KC_TAB SC_TAB
@@ -30,17 +33,36 @@
 #define KC_LSHIFT_REL SC_LSHIFT_REL
 #define KC_LCTRL_REL SC_LCTRL_REL
 #define KC_RSHIFT_REL SC_RSHIFT_REL
+#define KC_F1 SC_F1
+#define KC_PGUP SC_PGUP
+#define KC_PGDN SC_PGDN
 
 #define ASCII_BACKSPACE 8
 #define ASCII_HTAB 9
 #define ASCII_NEWLINE 10
 #define ASCII_CRETURN 15
+#define ASCII_ESCAPE 27
 
 /* structs */
 struct terminal_state {
     bool capitalize;
     bool alt_pressed;
     bool ctrl_pressed;
+    bool shift_pressed;
+};
+
+enum term_esc_state {ESC_NONE, ESC_START, ESC_CSI};
+
+/* state of the VT100 escape sequence parser and the attributes set by escape sequences */
+struct terminal_vt {
+    enum term_esc_state state;
+    uint32_t params[TERM_ESC_MAX_PARAMS];
+    uint32_t num_params;
+    bool private;               // the sequence started with '?'
+
+    uint8_t fg, bg;             // indices into the color table, or TERM_DEFAULT_COLOR
+    bool bold;                  // colors 0-7 are drawn bright
+    uint32_t saved_x, saved_y;  // cursor position saved with ESC[s
 };
 
 struct terminal {
@@ -50,6 +72,9 @@ struct terminal {
     /* terminal state */
     struct terminal_state ts;
 
+    /* escape sequence state */
+    struct terminal_vt vt;
+
     /* connected display driver */
     struct display *dis;
 
@@ -82,6 +107,18 @@ struct terminal {
      */
     int (*term_writes)(struct terminal *t, char *s);
 
+    /** write n characters to the terminal to be output to the display device
+     * VT100 escape sequences are interpreted, and the text between them is drawn as one batch
+     * not garunteed to be implemented
+     * 
+     * @param t: terminal to write to
+     * @param s: characters to write to terminal
+     * @param n: number of characters to write
+     * 
+     * @return implementation dependent
+     */
+    int (*term_writen)(struct terminal *t, const char *s, size_t n);
+
     /** write a character to the terminal to be input to the connected line discipline
      * 
      * @param t: terminal to write to
@@ -109,7 +146,10 @@ typedef struct terminal term_t;
 
 /* functions */
 int terminal_init(term_t *t, struct line_discipline *ld, struct display *dd);
+int terminal_attach(term_t *t, uint32_t console);
+void terminal_switch(uint32_t console);
 term_t *get_default_terminal();
+term_t *get_console_terminal(uint32_t console);
 
 /** gets the terminal_state struct of a terminal
  * 
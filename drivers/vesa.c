@@ -1,38 +1,135 @@
 /* Implements the VESA driver for drawing text and single pixels to the screen. 
- * Writes directly to the framebuffer and does no buffering itself */
+ * Everything is drawn to a backbuffer in RAM, which is never slow to read, and the
+ * regions drawn to are tracked as a dirty rectangle. vesa_flush() copies the dirty
+ * rectangle to the framebuffer a row at a time, converting it to the framebuffer's pixel format.
+ * 
+ * Text is kept in a ring of cells that starts at head_row, and the text rows of the backbuffer
+ * are a ring that starts at pixel_head. Scrolling bumps both heads and clears the new bottom
+ * row, so only the cells that change are drawn again. The rows of cells before head_row are
+ * the scrollback, up to SCROLLBACK_LINES of them. Scrolling the view back through them moves
+ * pixel_head the other way, so only the rows coming into view are drawn.
+ * 
+ * There are NUM_CONSOLES virtual consoles, each with its own grid of cells, cursor and colors.
+ * Only the console that is shown draws to the backbuffer, the others just update their cells
+ * until they are shown, when the whole grid is drawn again. Redrawing the screen can be asked
+ * for from an IRQ, so it is queued and done a row at a time with interrupts enabled in
+ * between, either by the next flush or before pixels are drawn over the rows.
+ * 
+ * The cursor is an overlay on the shown console: the cell under it is drawn in inverted colors,
+ * and drawn normally from the grid again to remove it. Showing, hiding and moving the cursor
+ * only change its state, the overlay is brought up to date once per flush and blinks
+ * whenever vesa_blink_cursor() is called. */
 
 /* includes */
 #include <stdint.h>
+#include <stdbool.h>
+#include <mem.h>
+#include <string.h>
+#include <kerrors.h>
 #include "../boot/multiboot.h"
 #include "../kernel/port_io.h"
+#include "../kernel/kalloc.h"
+#include "../kernel/cpu.h"
+#include "framebuffer.h"
+#include "display.h"
 #include "vesa.h"
 #include "vga_font.h"
 
 /* defines */
+#define GLYPH_LUT_SIZE 256
+
+/* structs */
+
+/* a rectangle of pixels from (x0, y0) up to but not including (x1, y1) */
+struct rect {
+    uint32_t x0, y0;
+    uint32_t x1, y1;
+};
+
+/* one row of a glyph as pixels, so a whole row is copied with a single assignment */
+struct glyph_row {
+    uint32_t px[FONT_WIDTH];
+};
+
+/* a character on the screen and the colors it is drawn in */
+struct cell {
+    char c;
+    uint32_t fg, bg;
+};
+
+/* a virtual console, everything about the text on the screen that isn't shared */
+struct console {
+    struct cell *cells;     // ring_rows * num_cols grid of text, a ring of rows starting at head_row
+    uint32_t head_row;      // row of cells at the top of the screen
+    uint32_t hist_len;      // number of rows of scrollback before head_row
+    uint32_t view;          // number of rows the view is scrolled back, 0 shows the live screen
+
+    uint32_t cursor_x;
+    uint32_t cursor_y;
+    uint32_t cursor_on;
+    uint32_t current_x;
+    uint32_t current_y;
+
+    uint32_t bg_color;
+    uint32_t fg_color;
+};
 
 /* globals */
-static uint32_t *framebuffer_addr;
+static framebuffer_t fb;
+static uint32_t *backbuffer;    // what is drawn to, the framebuffer itself if it couldn't be allocated
+static struct rect dirty;       // region of the screen that changed since the last flush
+static bool ring_pixels;        // whether the backbuffer's text rows are a ring starting at pixel_head
+static uint32_t pixel_head;     // row of the backbuffer at the top of the screen
+
+static struct console consoles[NUM_CONSOLES];
+static struct console *shown;           // the console drawn to the backbuffer
+static uint32_t (*console_hook)(void);  // gets the console the caller draws to, the shown one if NULL
+
+// the cursor overlay of the shown console
+static bool blink_on = true;        // whether the cursor is in the shown half of its blink
+static bool cursor_drawn = false;   // whether the overlay is on the backbuffer at (drawn_x, drawn_y)
+static uint32_t drawn_x, drawn_y;
+
+// rows of the screen that still have to be drawn from the shown console's view, none if y0 >= y1
+static uint32_t redraw_y0, redraw_y1;
+
+// maps a byte of a glyph to its row of pixels in lut_fg/lut_bg, the leftmost pixel is the high bit
+static struct glyph_row glyph_lut[GLYPH_LUT_SIZE];
+static uint32_t lut_fg, lut_bg;
+static bool lut_valid = false;
+
 static uint32_t width;
 static uint32_t height;
-static uint32_t pitch;
-static uint32_t bpp;
-static uint8_t red_mask, green_mask, blue_mask;
 
 static uint32_t num_rows;
 static uint32_t num_cols;
-
-static uint32_t cursor_x;
-static uint32_t cursor_y;
-static uint32_t cursor_on;
-static uint32_t current_x;
-static uint32_t current_y;
-
-static uint32_t bg_color;
-static uint32_t fg_color;
+static uint32_t ring_rows;      // rows of cells kept by each console, the screen and its scrollback
 
 /* prototypes */
-static void vesa_set_cursor_vis(uint8_t state);
-static void scroll();
+static void scroll(struct console *con);
+static void vesa_move_cursor(struct console *con, uint32_t x, uint32_t y);
+static void vesa_put_char(struct console *con, char c);
+static void vesa_mark_dirty(uint32_t x, uint32_t y, uint32_t w, uint32_t h);
+static struct console *vesa_console();
+static uint32_t *vesa_pixel(uint32_t x, uint32_t y);
+static struct cell *vesa_cell(struct console *con, uint32_t x, uint32_t y);
+static void vesa_draw_cell(struct console *con, uint32_t x, uint32_t y);
+static void vesa_draw_view_row(struct console *con, uint32_t y);
+static void vesa_queue_redraw(uint32_t y0, uint32_t y1);
+static void vesa_finish_redraw();
+static void vesa_fill_margins();
+static bool vesa_alloc_cells(uint32_t rows);
+static void vesa_draw_glyph(uint32_t x, uint32_t y, char c, uint32_t fg, uint32_t bg);
+static void vesa_update_cursor();
+static void vesa_remove_cursor();
+static void vesa_clear(struct console *con);
+static void vesa_clear_row(struct console *con, uint32_t y);
+static void vesa_clear_cells(struct console *con, uint32_t y);
+static void vesa_build_lut(uint32_t fg, uint32_t bg);
+static bool vesa_clip(uint32_t x, uint32_t y, uint32_t *w, uint32_t *h);
+static void vesa_fill(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t col);
+static void vesa_fill_back(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t col);
+static void vesa_copy(uint32_t src_x, uint32_t src_y, uint32_t w, uint32_t h, uint32_t dest_x, uint32_t dest_y);
 
 /* functions */
 
@@ -41,29 +138,133 @@ static void scroll();
  * @param mbi: pointer to the mbi given by GRUB2
  */
 void init_vesa(multiboot_info_t *mbi) {
-    framebuffer_addr = (uint32_t *) ((uint32_t) mbi->framebuffer_addr);
-    width = mbi->framebuffer_width;
-    height = mbi->framebuffer_height;
-    pitch = mbi->framebuffer_pitch;
-    bpp = mbi->framebuffer_bpp;
-    //shutdown if not in 32-bit color mode
-    if (bpp != 32 || mbi->framebuffer_type != MULTIBOOT_FRAMEBUFFER_TYPE_RGB)
+    //shutdown if not in a 16, 24 or 32-bit color mode
+    if (fb_init(&fb, mbi) != FB_SUCC)
         outw(0x604, 0x2000);
 
-    red_mask = 0xff << mbi->framebuffer_red_field_position;
-    green_mask = 0xff << mbi->framebuffer_green_field_position;
-    blue_mask = 0xff << mbi->framebuffer_blue_field_position;
+    width = fb.width;
+    height = fb.height;
+
+    // fall back to drawing straight to the framebuffer if there isn't room for a backbuffer,
+    // which only works if it has the same layout as the backbuffer
+    size_t buf_pages = (width * height * sizeof(uint32_t) + PG_SIZE - 1) / PG_SIZE;
+    backbuffer = (uint32_t *) palloc_mult(buf_pages);
+    if (backbuffer == NULL) {
+        if (!fb.native || fb.pitch != width * sizeof(uint32_t))
+            outw(0x604, 0x2000);
+
+        backbuffer = (uint32_t *) fb.addr;
+    }
+    
+    // the framebuffer can't be scrolled by moving a head, so it doesn't use a ring of rows
+    ring_pixels = backbuffer != (uint32_t *) fb.addr;
+    dirty.x0 = dirty.y0 = dirty.x1 = dirty.y1 = 0;
 
     num_cols = width / FONT_WIDTH;
     num_rows = height / FONT_HEIGHT;
 
-    cursor_x = 0;
-    cursor_y = 0;
-    current_x = 0;
-    current_y = 0;
+    // keep as much scrollback as there is memory for, shutdown if there isn't memory for the screens
+    ring_rows = num_rows + SCROLLBACK_LINES;
+    while (!vesa_alloc_cells(ring_rows)) {
+        if (ring_rows == num_rows)
+            outw(0x604, 0x2000);
+
+        ring_rows = num_rows + (ring_rows - num_rows) / 2;
+    }
+
+    for (uint32_t i = 0; i < NUM_CONSOLES; i++) {
+        struct console *con = consoles + i;
+
+        con->cursor_on = 0;
+        con->bg_color = BLACK;
+        con->fg_color = WHITE;
+    }
+
+    shown = consoles;
+    for (uint32_t i = 0; i < NUM_CONSOLES; i++)
+        vesa_clear(consoles + i);
+}
+
+/** sets the function used to find out which console a caller draws to
+ * 
+ * @param hook: function returning the number of the caller's console,
+ *              NULL to draw everything to the console that is shown
+ */
+void vesa_set_console_hook(uint32_t (*hook)(void)) {
+    console_hook = hook;
+}
+
+/** shows a virtual console on the screen, its whole grid of cells is drawn at the next flush
+ * 
+ * @param n: number of the console to show
+ */
+void vesa_show_console(uint32_t n) {
+    if (n >= NUM_CONSOLES || consoles + n == shown)
+        return;
+
+    uint32_t flags = cpu_irq_save();
+    shown = consoles + n;
+    vesa_queue_redraw(0, num_rows);
+    cpu_irq_restore(flags);
+
+    vesa_fill_margins();
+}
+
+/** scrolls the view of the caller's console through its scrollback
+ * if the view only moves part of a screen, the rows still in view are kept
+ * and only the rows coming into view are drawn, at the next flush
+ * 
+ * @param rows: number of rows to scroll back, negative to scroll forward towards the live screen
+ */
+void vesa_scrollback(int32_t rows) {
+    struct console *con = vesa_console();
+
+    uint32_t flags = cpu_irq_save();
+    int32_t view = (int32_t) con->view + rows;
+    if (view < 0)
+        view = 0;
+    else if ((uint32_t) view > con->hist_len)
+        view = con->hist_len;
+
+    uint32_t old = con->view;
+    uint32_t n = (uint32_t) view > old ? (uint32_t) view - old : old - (uint32_t) view;
+    if (n == 0) {
+        cpu_irq_restore(flags);
+        return;
+    }
+
+    // the overlay can only be removed while the live screen is in view
+    if (con == shown)
+        vesa_remove_cursor();
+    
+    con->view = view;
+    if (con != shown) {
+        cpu_irq_restore(flags);
+        return;
+    }
 
-    bg_color = BLACK;
-    fg_color = WHITE;
+    // rows already queued would move with the pixels, so moving them redraws everything
+    if (!ring_pixels || n >= num_rows || redraw_y0 < redraw_y1) {
+        vesa_queue_redraw(0, num_rows);
+    } else if (con->view > old) {
+        // the rows in view move down, the rows coming in are at the top
+        pixel_head = (pixel_head + num_rows - n) % num_rows;
+        vesa_queue_redraw(0, n);
+        vesa_mark_dirty(0, 0, width, num_rows * FONT_HEIGHT);
+    } else {
+        pixel_head = (pixel_head + n) % num_rows;
+        vesa_queue_redraw(num_rows - n, num_rows);
+        vesa_mark_dirty(0, 0, width, num_rows * FONT_HEIGHT);
+    }
+    cpu_irq_restore(flags);
+}
+
+/** gets the number of the console shown on the screen
+ * 
+ * @return number of the shown console
+ */
+uint32_t vesa_get_shown_console() {
+    return shown - consoles;
 }
 
 /** sets the position of the cursor
@@ -72,13 +273,7 @@ void init_vesa(multiboot_info_t *mbi) {
  * @param y: y coordinate to set the cursor to
  */
 void vesa_set_cursor(uint32_t x, uint32_t y) {
-    if (y <= num_rows && x <= num_cols) {
-        current_x = FONT_WIDTH * x;
-        cursor_x = x;
-
-        current_y = FONT_HEIGHT * y;
-        cursor_y = y;
-    }
+    vesa_move_cursor(vesa_console(), x, y);
 }
 
 /** gets the x coordinate of the cursor
@@ -86,7 +281,7 @@ void vesa_set_cursor(uint32_t x, uint32_t y) {
  * @return x coordinate of cursor
  */
 uint32_t vesa_get_cursor_x() {
-    return cursor_x;
+    return vesa_console()->cursor_x;
 }
 
 /** gets the y coordinate of the cursor
@@ -94,7 +289,7 @@ uint32_t vesa_get_cursor_x() {
  * @return y coordinate of cursor
  */
 uint32_t vesa_get_cursor_y() {
-    return cursor_y;
+    return vesa_console()->cursor_y;
 }
 
 /** gets whether the cursor is currently visible
@@ -102,18 +297,7 @@ uint32_t vesa_get_cursor_y() {
  * @return 1 if cursor is visble, 0 otherwise
  */
 uint32_t vesa_get_cursor_vis() {
-    return cursor_on;
-}
-
-/** sets the visibility of the cursor
- * 
- * @param state: state to set the cursor to: 1 for on, 0 for off
- */
-static void vesa_set_cursor_vis(uint8_t state) {
-    if (state == 1)
-        vesa_show_cursor();
-    else
-        vesa_hide_cursor();
+    return vesa_console()->cursor_on;
 }
 
 /** gets the number of cursor columns
@@ -132,40 +316,27 @@ uint32_t vesa_get_num_rows() {
     return num_rows;
 }
 
-/** turns on the cursor */
+/** turns on the cursor, it is drawn at the next flush
+ * the blink restarts in its shown half, so the cursor doesn't vanish while typing
+ */
 void vesa_show_cursor() {
-    uint32_t *pixel_pos = framebuffer_addr + (current_y * width) + current_x;
-
-    int i;
-    for (i = 0; i < FONT_HEIGHT; i++) {
-        char c_font = (char) vga_font[(219 * FONT_HEIGHT) + i];
-
-        int j;
-        for (j = 0; j < FONT_WIDTH; j++)
-            if (c_font & (1 << j))
-                pixel_pos[FONT_WIDTH - j] = fg_color;
-        
-        pixel_pos += width;
-    }
+    struct console *con = vesa_console();
 
-    cursor_on = 1;
+    con->cursor_on = 1;
+    if (con == shown)
+        blink_on = true;
 }
 
-/** hides the cursor */
+/** turns off the cursor, it is removed at the next flush */
 void vesa_hide_cursor() {
-    uint32_t *pixel_pos = framebuffer_addr + (current_y * width) + current_x;
-
-    int i;
-    for (i = 0; i < FONT_HEIGHT; i++) {
-
-        int j;
-        for (j = 0; j < FONT_WIDTH; j++)
-            pixel_pos[FONT_WIDTH - j] = bg_color;
-        
-        pixel_pos += width;
-    }
+    vesa_console()->cursor_on = 0;
+}
 
-    cursor_on = 0;
+/** switches the cursor between the shown and hidden halves of its blink
+ * meant to be called regularly by a timer, the change is drawn at the next flush
+ */
+void vesa_blink_cursor() {
+    blink_on = !blink_on;
 }
 
 /** prints an ASCII character to the current cursor position
@@ -173,65 +344,67 @@ void vesa_hide_cursor() {
  * @param c: character to print
  */
 void vesa_print_char(char c) {
-    if (c == '\n') {
-        vesa_hide_cursor();
-        vesa_set_cursor(0, cursor_y + 1);
-        scroll();
-        return;
-    } else if (c == '\t') {
-        vesa_hide_cursor();
+    vesa_put_char(vesa_console(), c);
+}
 
-        if (cursor_x <= num_cols - 4)
-            vesa_set_cursor(cursor_x + 4, cursor_y);
-        else
-            vesa_set_cursor(cursor_x + (num_cols - 4), cursor_y);
+/** prints n characters to the current cursor position
+ * the caller's console is only looked up once for the whole batch
+ * 
+ * @param s: characters to print
+ * @param n: number of characters to print
+ */
+void vesa_write(const char *s, size_t n) {
+    struct console *con = vesa_console();
+
+    for (size_t i = 0; i < n; i++)
+        vesa_put_char(con, s[i]);
+}
 
+/** erases n characters to blanks in the background color, starting at cursor position (x, y)
+ * and continuing onto the following rows, without moving the cursor
+ * 
+ * @param x: x coordinate to start erasing at
+ * @param y: y coordinate to start erasing at
+ * @param n: number of characters to erase
+ */
+void vesa_erase(uint32_t x, uint32_t y, uint32_t n) {
+    struct console *con = vesa_console();
+    uint32_t end = num_rows * num_cols;
+    uint32_t i = y * num_cols + x;
+
+    if (x > num_cols || y >= num_rows)
         return;
-    }
 
-    uint32_t *pixel_pos = framebuffer_addr + (current_y * width) + current_x;
+    if (n < end - i)
+        end = i + n;
 
-    int i;
-    for (i = 0; i < FONT_HEIGHT; i++) {
-        char c_font = (char) vga_font[(c * FONT_HEIGHT) + i];
-
-        int j;
-        for (j = 0; j < FONT_WIDTH; j++) {
-            if (c_font & (1 << j))
-                pixel_pos[FONT_WIDTH - j] = fg_color;
-            else
-                pixel_pos[FONT_WIDTH - j] = bg_color;
+    for (; i < end; i++) {
+        // whole rows are cleared with one fill
+        if (i % num_cols == 0 && end - i >= num_cols) {
+            vesa_clear_row(con, i / num_cols);
+            i += num_cols - 1;
+            continue;
         }
-        
-        pixel_pos += width;
-    }
 
-    current_x += FONT_WIDTH;
-    cursor_x++;
-    scroll();
+        struct cell *cell = vesa_cell(con, i % num_cols, i / num_cols);
+        cell->c = ' ';
+        cell->fg = con->fg_color;
+        cell->bg = con->bg_color;
+        vesa_draw_cell(con, i % num_cols, i / num_cols);
+    }
 }
 
 /** prints a backspace to the current cursor position */
 void vesa_print_backspace() {
-    uint8_t old_vis = vesa_get_cursor_vis();
-    vesa_hide_cursor();
-    vesa_set_cursor(--cursor_x, cursor_y);
+    struct console *con = vesa_console();
+    vesa_move_cursor(con, con->cursor_x - 1, con->cursor_y);
 
-    uint32_t *pixel_pos = framebuffer_addr + (current_y * width) + current_x;
+    struct cell *cell = vesa_cell(con, con->cursor_x, con->cursor_y);
+    cell->c = ' ';
+    cell->bg = con->bg_color;
+    vesa_draw_cell(con, con->cursor_x, con->cursor_y);
 
-    int i;
-    for (i = 0; i < FONT_HEIGHT; i++) {
-
-        int j;
-        for (j = 0; j < FONT_WIDTH; j++)
-            pixel_pos[FONT_WIDTH - j] = bg_color;
-        
-        pixel_pos += width;
-    }
-
-    vesa_set_cursor_vis(old_vis);
-
-    scroll();
+    scroll(con);
 }
 
 /** prints a null-terminated string to the current cursor position
@@ -239,9 +412,7 @@ void vesa_print_backspace() {
  * @param s: null-terminated string to print
  */
 void vesa_print(const char *string) {
-    int i;
-    for (i = 0; string[i] != 0; i++)
-        vesa_print_char(string[i]);
+    vesa_write(string, strlen(string));
 }
 
 /** prints a null-terminated string to the current cursor position
@@ -257,45 +428,572 @@ void vesa_println(const char *string) {
 }
 
 /** draws a pixel on the screen
+ * pixels are only drawn if the caller's console is shown, they aren't kept per console
  * 
  * @param x: x coordinate to draw at
  * @param y: y coordinate to draw at
  * @param col: color to draw as a 32 bit RGB value
  */
 void vesa_draw(uint32_t x, uint32_t y, uint32_t col) {
-    uint32_t *pixel_pos = framebuffer_addr + (y * width) + x;
-    *pixel_pos = col;
+    vesa_finish_redraw();
+    if (x >= width || y >= height || vesa_console() != shown)
+        return;
+
+    *vesa_pixel(x, y) = col;
+    vesa_mark_dirty(x, y, 1, 1);
 }
 
-/** clears the screen */
+/** fills a rectangle of the screen with a color
+ * pixels are only drawn if the caller's console is shown, they aren't kept per console
+ * 
+ * @param x: x coordinate of the top left of the rectangle
+ * @param y: y coordinate of the top left of the rectangle
+ * @param w: width of the rectangle in pixels
+ * @param h: height of the rectangle in pixels
+ * @param col: color to fill with as a 32 bit RGB value
+ */
+void vesa_fill_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t col) {
+    vesa_finish_redraw();
+    if (vesa_console() == shown)
+        vesa_fill(x, y, w, h, col);
+}
+
+/** copies a rectangle of pixels to the screen
+ * pixels are only drawn if the caller's console is shown, they aren't kept per console
+ * 
+ * @param src: pixels to copy as 32 bit RGB values, row by row
+ * @param stride: number of pixels from the start of one row of src to the next
+ * @param x: x coordinate of the top left of the rectangle
+ * @param y: y coordinate of the top left of the rectangle
+ * @param w: width of the rectangle in pixels
+ * @param h: height of the rectangle in pixels
+ */
+void vesa_blit(const uint32_t *src, uint32_t stride, uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    vesa_finish_redraw();
+    if (src == NULL || vesa_console() != shown || !vesa_clip(x, y, &w, &h))
+        return;
+
+    for (uint32_t i = 0; i < h; i++, src += stride)
+        memcpy(vesa_pixel(x, y + i), src, w * sizeof(uint32_t));
+
+    vesa_mark_dirty(x, y, w, h);
+}
+
+/** copies a rectangle of the screen to another place on the screen
+ * pixels are only drawn if the caller's console is shown, they aren't kept per console
+ * 
+ * @param src_x: x coordinate of the top left of the rectangle to copy
+ * @param src_y: y coordinate of the top left of the rectangle to copy
+ * @param w: width of the rectangle in pixels
+ * @param h: height of the rectangle in pixels
+ * @param dest_x: x coordinate to copy the top left of the rectangle to
+ * @param dest_y: y coordinate to copy the top left of the rectangle to
+ */
+void vesa_copy_rect(uint32_t src_x, uint32_t src_y, uint32_t w, uint32_t h, uint32_t dest_x, uint32_t dest_y) {
+    vesa_finish_redraw();
+    if (vesa_console() == shown)
+        vesa_copy(src_x, src_y, w, h, dest_x, dest_y);
+}
+
+/** clears the screen of the caller's console */
 void vesa_clear_screen() {
-    uint32_t x;
-    uint32_t y;
-    for (y = 0; y < height; y++)
-        for (x = 0; x < width; x++)
-            framebuffer_addr[(y * width) + x] = bg_color;
+    vesa_clear(vesa_console());
+}
+
+/** copies everything drawn since the last flush from the backbuffer to the framebuffer
+ * queued rows are drawn and the cursor overlay is updated first, and the dirty rectangle
+ * is copied a row at a time, so each row is one bulk copy
+ */
+void vesa_flush() {
+    vesa_finish_redraw();
+
+    uint32_t flags = cpu_irq_save();
+    vesa_update_cursor();
+    struct rect r = dirty;
+    dirty.x0 = dirty.y0 = dirty.x1 = dirty.y1 = 0;
+    cpu_irq_restore(flags);
+
+    if (!ring_pixels || r.x0 >= r.x1 || r.y0 >= r.y1)
+        return;
     
-    vesa_set_cursor(0, 0);
+    for (uint32_t y = r.y0; y < r.y1; y++)
+        fb_write(&fb, r.x0, y, vesa_pixel(r.x0, y), r.x1 - r.x0);
+}
+
+/** moves the cursor of a console
+ * 
+ * @param con: console to move the cursor of
+ * @param x: x coordinate to move the cursor to
+ * @param y: y coordinate to move the cursor to
+ */
+static void vesa_move_cursor(struct console *con, uint32_t x, uint32_t y) {
+    if (y < num_rows && x <= num_cols) {
+        con->current_x = FONT_WIDTH * x;
+        con->cursor_x = x;
+
+        con->current_y = FONT_HEIGHT * y;
+        con->cursor_y = y;
+    }
+}
+
+/** prints an ASCII character to the cursor position of a console
+ * 
+ * @param con: console to print to
+ * @param c: character to print
+ */
+static void vesa_put_char(struct console *con, char c) {
+    if (c == '\n') {
+        con->cursor_x = num_cols;   // scroll() moves to the start of the next row
+        scroll(con);
+        return;
+    } else if (c == '\r') {
+        vesa_move_cursor(con, 0, con->cursor_y);
+        return;
+    } else if (c == '\t') {
+        // a tab past the end of the row stops at num_cols, so the next character wraps
+        if (con->cursor_x + 4 <= num_cols)
+            vesa_move_cursor(con, con->cursor_x + 4, con->cursor_y);
+        else
+            vesa_move_cursor(con, num_cols, con->cursor_y);
+
+        return;
+    }
+
+    // the cursor can be left just past the end of the row, which isn't a cell
+    if (con->cursor_x >= num_cols)
+        scroll(con);
+
+    struct cell *cell = vesa_cell(con, con->cursor_x, con->cursor_y);
+    cell->c = c;
+    cell->fg = con->fg_color;
+    cell->bg = con->bg_color;
+    vesa_draw_cell(con, con->cursor_x, con->cursor_y);
+
+    con->current_x += FONT_WIDTH;
+    con->cursor_x++;
+    scroll(con);
 }
 
-/** scrolls the screen */
-static void scroll() {
-    if (cursor_x >= num_cols) {
-        current_y += FONT_HEIGHT;
-        cursor_y++;
-        current_x = 0;
-        cursor_x = 0;
+/** scrolls a console
+ * 
+ * @param con: console to scroll
+ */
+static void scroll(struct console *con) {
+    if (con->cursor_x >= num_cols) {
+        con->current_y += FONT_HEIGHT;
+        con->cursor_y++;
+        con->current_x = 0;
+        con->cursor_x = 0;
     }
     
-    if (cursor_y >= num_rows) {
-        uint32_t x;
-        uint32_t y;
-        for (y = 0; y < height - 1; y++)
-            for (x = 0; x < width; x++)
-                framebuffer_addr[(y * width) + x] = framebuffer_addr[((y  + FONT_HEIGHT) * width) + x];
+    if (con->cursor_y >= num_rows) {
+        // the top row becomes the new bottom row, so nothing has to be moved
+        uint32_t flags = cpu_irq_save();
+        bool live = con == shown && con->view == 0;
+
+        // the overlay would move up with the pixels under it
+        if (live)
+            vesa_remove_cursor();
+
+        // the top row becomes scrollback, and the oldest row of scrollback the new bottom row once the ring is full
+        con->head_row = (con->head_row + 1) % ring_rows;
+        if (con->hist_len < ring_rows - num_rows)
+            con->hist_len++;
+
+        if (live && ring_pixels) {
+            pixel_head = (pixel_head + 1) % num_rows;
+            vesa_mark_dirty(0, 0, width, num_rows * FONT_HEIGHT);
+        } else if (live) {
+            vesa_copy(0, FONT_HEIGHT, width, (num_rows - 1) * FONT_HEIGHT, 0, 0);
+        }
+
+        // queued rows moved up with the pixels, the new bottom row is cleared below
+        if (live && redraw_y0 < redraw_y1 && redraw_y0 > 0)
+            redraw_y0--;
+
+        // a view into the scrollback keeps showing the same rows, unless they were overwritten
+        if (con->view > 0 && con->view < con->hist_len)
+            con->view++;
+        else if (con->view > 0 && con == shown)
+            vesa_queue_redraw(0, num_rows);
+        cpu_irq_restore(flags);
+
+        vesa_clear_row(con, num_rows - 1);
     
-        vesa_set_cursor(0, num_rows - 1);
+        con->cursor_x = con->current_x = 0;
+        con->cursor_y = num_rows - 1;
+        con->current_y = con->cursor_y * FONT_HEIGHT;
+    }
+}
+
+/** gets the console the caller draws to
+ * 
+ * @return pointer to the caller's console
+ */
+static struct console *vesa_console() {
+    uint32_t n = console_hook != NULL ? console_hook() : NUM_CONSOLES;
+    return n < NUM_CONSOLES ? consoles + n : shown;
+}
+
+/** gets the backbuffer address of the pixel at (x, y) on the screen
+ * rows of text are mapped through the ring starting at pixel_head,
+ * the pixels below the last full row of text aren't part of the ring
+ * 
+ * @param x: x coordinate of the pixel
+ * @param y: y coordinate of the pixel
+ * 
+ * @return pointer to the pixel in the backbuffer
+ */
+static uint32_t *vesa_pixel(uint32_t x, uint32_t y) {
+    uint32_t row = y / FONT_HEIGHT;
+
+    if (ring_pixels && row < num_rows)
+        y = ((pixel_head + row) % num_rows) * FONT_HEIGHT + (y % FONT_HEIGHT);
+
+    return backbuffer + (y * width) + x;
+}
+
+/** gets the cell at (x, y) of the live screen of a console
+ * 
+ * @param con: console to get the cell of
+ * @param x: column of the cell
+ * @param y: row of the cell
+ * 
+ * @return pointer to the cell
+ */
+static struct cell *vesa_cell(struct console *con, uint32_t x, uint32_t y) {
+    return con->cells + ((con->head_row + y) % ring_rows) * num_cols + x;
+}
+
+/** draws the cell at (x, y) of a console to the backbuffer if the console is shown
+ * and its live screen is in view, drawing the cell under the cursor overlay removes it
+ * 
+ * @param con: console to draw the cell of
+ * @param x: column of the cell
+ * @param y: row of the cell
+ */
+static void vesa_draw_cell(struct console *con, uint32_t x, uint32_t y) {
+    // keeps the console from being switched while the glyph is half drawn
+    uint32_t flags = cpu_irq_save();
+    if (con != shown || con->view != 0) {
+        cpu_irq_restore(flags);
+        return;
+    }
+
+    struct cell *cell = vesa_cell(con, x, y);
+    vesa_draw_glyph(x, y, cell->c, cell->fg, cell->bg);
+
+    if (cursor_drawn && x == drawn_x && y == drawn_y)
+        cursor_drawn = false;
+    cpu_irq_restore(flags);
+}
+
+/** draws a row of the screen of the shown console from the rows of cells in its view
+ * 
+ * @param con: shown console to draw the row of
+ * @param y: row of the screen to draw
+ */
+static void vesa_draw_view_row(struct console *con, uint32_t y) {
+    struct cell *cell = con->cells + ((con->head_row + ring_rows - con->view + y) % ring_rows) * num_cols;
+
+    for (uint32_t x = 0; x < num_cols; x++)
+        vesa_draw_glyph(x, y, cell[x].c, cell[x].fg, cell[x].bg);
+
+    if (cursor_drawn && drawn_y == y)
+        cursor_drawn = false;
+}
+
+/** queues rows of the screen to be drawn from the shown console's view
+ * must be called with interrupts disabled
+ * 
+ * @param y0: first row to draw
+ * @param y1: row after the last row to draw
+ */
+static void vesa_queue_redraw(uint32_t y0, uint32_t y1) {
+    // rows are only queued as one range, so two ranges become the whole screen
+    if (redraw_y0 < redraw_y1) {
+        y0 = 0;
+        y1 = num_rows;
+    }
+
+    redraw_y0 = y0;
+    redraw_y1 = y1;
+}
+
+/** draws the queued rows of the screen from the shown console's view
+ * interrupts are only disabled while each row is drawn, and the queue is checked again
+ * before every row, so rows queued or moved in the meantime are drawn where they are now
+ */
+static void vesa_finish_redraw() {
+    while (redraw_y0 < redraw_y1) {
+        uint32_t flags = cpu_irq_save();
+        if (redraw_y0 < redraw_y1)
+            vesa_draw_view_row(shown, redraw_y0++);
+        cpu_irq_restore(flags);
+    }
+}
+
+/** fills the pixels to the right of and below the rows of text, which aren't part of any console,
+ * in the shown console's background color
+ */
+static void vesa_fill_margins() {
+    uint32_t flags = cpu_irq_save();
+    vesa_fill(num_cols * FONT_WIDTH, 0, width - num_cols * FONT_WIDTH, num_rows * FONT_HEIGHT, shown->bg_color);
+    vesa_fill(0, num_rows * FONT_HEIGHT, width, height - num_rows * FONT_HEIGHT, shown->bg_color);
+    cpu_irq_restore(flags);
+}
+
+/** draws a glyph to the backbuffer at cell position (x, y) of the shown console
+ * each row of the glyph is looked up in the glyph lut and copied as a whole
+ * 
+ * @param x: column to draw at
+ * @param y: row to draw at
+ * @param c: character to draw
+ * @param fg: color of the character
+ * @param bg: color behind the character
+ */
+static void vesa_draw_glyph(uint32_t x, uint32_t y, char c, uint32_t fg, uint32_t bg) {
+    struct glyph_row *pixel_pos = (struct glyph_row *) vesa_pixel(x * FONT_WIDTH, y * FONT_HEIGHT);
+    const uint8_t *glyph = vga_font + ((uint8_t) c * FONT_HEIGHT);
+
+    if (!lut_valid || fg != lut_fg || bg != lut_bg)
+        vesa_build_lut(fg, bg);
+
+    int i;
+    for (i = 0; i < FONT_HEIGHT; i++) {
+        *pixel_pos = glyph_lut[glyph[i]];
+        pixel_pos = (struct glyph_row *) ((uint32_t *) pixel_pos + width);
+    }
+
+    vesa_mark_dirty(x * FONT_WIDTH, y * FONT_HEIGHT, FONT_WIDTH, FONT_HEIGHT);
+}
+
+/** brings the cursor overlay up to date with the shown console's cursor
+ * only the cell the overlay leaves and the cell it goes to are drawn
+ */
+static void vesa_update_cursor() {
+    bool visible = shown->cursor_on && blink_on && shown->view == 0 && shown->cursor_x < num_cols;
+
+    if (cursor_drawn && (!visible || drawn_x != shown->cursor_x || drawn_y != shown->cursor_y))
+        vesa_remove_cursor();
+
+    if (visible && !cursor_drawn) {
+        struct cell *cell = vesa_cell(shown, shown->cursor_x, shown->cursor_y);
+        vesa_draw_glyph(shown->cursor_x, shown->cursor_y, cell->c, cell->bg, cell->fg);
+
+        drawn_x = shown->cursor_x;
+        drawn_y = shown->cursor_y;
+        cursor_drawn = true;
+    }
+}
+
+/** removes the cursor overlay by drawing the cell under it from the grid */
+static void vesa_remove_cursor() {
+    if (cursor_drawn)
+        vesa_draw_cell(shown, drawn_x, drawn_y);
+}
+
+/** fills the glyph lut with the rows of pixels for every byte of a glyph in the given colors
+ * text is usually drawn in one pair of colors, so the lut rarely has to be rebuilt
+ * 
+ * @param fg: color of set bits
+ * @param bg: color of clear bits
+ */
+static void vesa_build_lut(uint32_t fg, uint32_t bg) {
+    for (uint32_t b = 0; b < GLYPH_LUT_SIZE; b++)
+        for (uint32_t j = 0; j < FONT_WIDTH; j++)
+            glyph_lut[b].px[j] = (b & (0x80 >> j)) ? fg : bg;
+
+    lut_fg = fg;
+    lut_bg = bg;
+    lut_valid = true;
+}
+
+/** clears the screen of a console and moves its cursor to the top left
+ * the scrollback is kept, and the view goes back to the live screen
+ * the screen is cleared a row at a time, so interrupts are only disabled for one row at once
+ * 
+ * @param con: console to clear
+ */
+static void vesa_clear(struct console *con) {
+    con->view = 0;
+    for (uint32_t y = 0; y < num_rows; y++)
+        vesa_clear_row(con, y);
+
+    if (con == shown)
+        vesa_fill_margins();
+    
+    con->cursor_x = con->current_x = 0;
+    con->cursor_y = con->current_y = 0;
+}
+
+/** clears a row of cells to blanks in the background color and erases it from the backbuffer
+ * 
+ * @param con: console to clear the row of
+ * @param y: row to clear
+ */
+static void vesa_clear_row(struct console *con, uint32_t y) {
+    vesa_clear_cells(con, y);
+
+    uint32_t flags = cpu_irq_save();
+    if (con == shown && con->view == 0) {
+        vesa_fill(0, y * FONT_HEIGHT, width, FONT_HEIGHT, con->bg_color);
+
+        if (cursor_drawn && drawn_y == y)
+            cursor_drawn = false;
+    }
+    cpu_irq_restore(flags);
+}
+
+/** clears a row of cells to blanks in the background color without drawing them
+ * 
+ * @param con: console to clear the row of
+ * @param y: row to clear
+ */
+static void vesa_clear_cells(struct console *con, uint32_t y) {
+    struct cell *cell = vesa_cell(con, 0, y);
+
+    for (uint32_t x = 0; x < num_cols; x++) {
+        cell[x].c = ' ';
+        cell[x].fg = con->fg_color;
+        cell[x].bg = con->bg_color;
+    }
+}
+
+/** allocates the ring of cells of every console
+ * 
+ * @param rows: number of rows of cells in each ring
+ * 
+ * @return true if every ring was allocated, false if none were
+ */
+static bool vesa_alloc_cells(uint32_t rows) {
+    size_t cell_pages = (rows * num_cols * sizeof(struct cell) + PG_SIZE - 1) / PG_SIZE;
+
+    for (uint32_t i = 0; i < NUM_CONSOLES; i++) {
+        consoles[i].cells = (struct cell *) palloc_mult(cell_pages);
+
+        if (consoles[i].cells == NULL) {
+            while (i-- > 0)
+                pfree_mult(consoles[i].cells, cell_pages);
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** clips a rectangle to the screen
+ * 
+ * @param x: x coordinate of the top left of the rectangle
+ * @param y: y coordinate of the top left of the rectangle
+ * @param w: width of the rectangle, shrunk to fit on the screen
+ * @param h: height of the rectangle, shrunk to fit on the screen
+ * 
+ * @return false if none of the rectangle is on the screen, true otherwise
+ */
+static bool vesa_clip(uint32_t x, uint32_t y, uint32_t *w, uint32_t *h) {
+    if (x >= width || y >= height)
+        return false;
+
+    if (*w > width - x)
+        *w = width - x;
+    if (*h > height - y)
+        *h = height - y;
+
+    return *w > 0 && *h > 0;
+}
+
+/** fills a rectangle of the backbuffer with a color and marks it dirty
+ * each row of the rectangle is contiguous in the backbuffer, so it is one bulk fill
+ * 
+ * @param x: x coordinate of the top left of the rectangle
+ * @param y: y coordinate of the top left of the rectangle
+ * @param w: width of the rectangle in pixels
+ * @param h: height of the rectangle in pixels
+ * @param col: color to fill with as a 32 bit RGB value
+ */
+static void vesa_fill(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t col) {
+    if (!vesa_clip(x, y, &w, &h))
+        return;
+
+    vesa_fill_back(x, y, w, h, col);
+    vesa_mark_dirty(x, y, w, h);
+}
+
+/** fills a rectangle of the backbuffer with a color without marking it dirty
+ * the rectangle must already be clipped to the screen
+ * 
+ * @param x: x coordinate of the top left of the rectangle
+ * @param y: y coordinate of the top left of the rectangle
+ * @param w: width of the rectangle in pixels
+ * @param h: height of the rectangle in pixels
+ * @param col: color to fill with as a 32 bit RGB value
+ */
+static void vesa_fill_back(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t col) {
+    // whole rows are contiguous in the backbuffer, so a ring row fills with one call
+    if (x == 0 && w == width && y % FONT_HEIGHT == 0 && h == FONT_HEIGHT) {
+        memset32(vesa_pixel(0, y), col, width * FONT_HEIGHT);
+        return;
+    }
+
+    for (uint32_t i = 0; i < h; i++)
+        memset32(vesa_pixel(x, y + i), col, w);
+}
+
+/** copies a rectangle of the backbuffer to another place in it and marks it dirty
+ * the rectangles may overlap, rows are copied in the order that doesn't
+ * overwrite a row before it's read
+ * 
+ * @param src_x: x coordinate of the top left of the rectangle to copy
+ * @param src_y: y coordinate of the top left of the rectangle to copy
+ * @param w: width of the rectangle in pixels
+ * @param h: height of the rectangle in pixels
+ * @param dest_x: x coordinate to copy the top left of the rectangle to
+ * @param dest_y: y coordinate to copy the top left of the rectangle to
+ */
+static void vesa_copy(uint32_t src_x, uint32_t src_y, uint32_t w, uint32_t h, uint32_t dest_x, uint32_t dest_y) {
+    if (!vesa_clip(src_x, src_y, &w, &h) || !vesa_clip(dest_x, dest_y, &w, &h))
+        return;
+
+    if (dest_y <= src_y) {
+        for (uint32_t i = 0; i < h; i++)
+            memmove(vesa_pixel(dest_x, dest_y + i), vesa_pixel(src_x, src_y + i), w * sizeof(uint32_t));
+    } else {
+        for (uint32_t i = h; i > 0; i--)
+            memmove(vesa_pixel(dest_x, dest_y + i - 1), vesa_pixel(src_x, src_y + i - 1), w * sizeof(uint32_t));
+    }
+
+    vesa_mark_dirty(dest_x, dest_y, w, h);
+}
+
+/** adds a region of the screen to the dirty rectangle
+ * 
+ * @param x: x coordinate of the region in pixels
+ * @param y: y coordinate of the region in pixels
+ * @param w: width of the region in pixels
+ * @param h: height of the region in pixels
+ */
+static void vesa_mark_dirty(uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    uint32_t x1 = x + w > width ? width : x + w;
+    uint32_t y1 = y + h > height ? height : y + h;
+
+    if (x >= x1 || y >= y1)
+        return;
+
+    uint32_t flags = cpu_irq_save();
+    if (dirty.x0 >= dirty.x1 || dirty.y0 >= dirty.y1) {
+        dirty.x0 = x;
+        dirty.y0 = y;
+        dirty.x1 = x1;
+        dirty.y1 = y1;
+    } else {
+        dirty.x0 = x < dirty.x0 ? x : dirty.x0;
+        dirty.y0 = y < dirty.y0 ? y : dirty.y0;
+        dirty.x1 = x1 > dirty.x1 ? x1 : dirty.x1;
+        dirty.y1 = y1 > dirty.y1 ? y1 : dirty.y1;
     }
+    cpu_irq_restore(flags);
 }
 
 /** sets the color to write text to the screen in
@@ -304,8 +1002,9 @@ static void scroll() {
  * @param bg: background color to write in as a 32 bit RGB value
  */
 void vesa_set_color(uint32_t fg, uint32_t bg) {
-    fg_color = fg;
-    bg_color = bg;
+    struct console *con = vesa_console();
+    con->fg_color = fg;
+    con->bg_color = bg;
 }
 
 /** sets the foreground color to write text to the screen in
@@ -313,7 +1012,7 @@ void vesa_set_color(uint32_t fg, uint32_t bg) {
  * @param fg: foreground color to write in as a 32 bit RGB value
  */
 void vesa_set_fg_color(uint32_t fg) {
-    fg_color = fg;
+    vesa_console()->fg_color = fg;
 }
 
 /** sets the background color to write text to the screen in
@@ -321,11 +1020,12 @@ void vesa_set_fg_color(uint32_t fg) {
  * @param fg: background color to write in as a 32 bit RGB value
  */
 void vesa_set_bg_color(uint32_t bg) {
-    bg_color = bg;
+    vesa_console()->bg_color = bg;
 }
 
 /** sets the color to white foreground on a black background for text */
 void vesa_set_default_color() {
-    fg_color = WHITE;
-    bg_color = BLACK;
+    struct console *con = vesa_console();
+    con->fg_color = WHITE;
+    con->bg_color = BLACK;
 }
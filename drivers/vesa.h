@@ -4,6 +4,7 @@
 
 /* includes */
 #include <stdint.h>
+#include <stddef.h>
 #include "../boot/multiboot.h"
 
 /* defines */
@@ -21,6 +22,10 @@
 
 /* functions */
 void init_vesa(multiboot_info_t *mbi);
+void vesa_set_console_hook(uint32_t (*hook)(void));
+void vesa_show_console(uint32_t n);
+void vesa_scrollback(int32_t rows);
+uint32_t vesa_get_shown_console();
 void vesa_set_cursor(uint32_t x, uint32_t y);
 uint32_t vesa_get_cursor_x();
 uint32_t vesa_get_cursor_y();
@@ -29,16 +34,23 @@ uint32_t vesa_get_num_cols();
 uint32_t vesa_get_num_rows();
 void vesa_show_cursor();
 void vesa_hide_cursor();
+void vesa_blink_cursor();
 void vesa_print_char(char c);
+void vesa_write(const char *s, size_t n);
+void vesa_erase(uint32_t x, uint32_t y, uint32_t n);
 void vesa_print_backspace();
 void vesa_print(const char *string);
 void vesa_println(const char *string);
 void vesa_print_align(const char *string, uint16_t alignment);
 void vesa_draw(uint32_t x, uint32_t y, uint32_t col);
+void vesa_fill_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t col);
+void vesa_blit(const uint32_t *src, uint32_t stride, uint32_t x, uint32_t y, uint32_t w, uint32_t h);
+void vesa_copy_rect(uint32_t src_x, uint32_t src_y, uint32_t w, uint32_t h, uint32_t dest_x, uint32_t dest_y);
 void vesa_clear_screen();
 void vesa_set_color(uint32_t fg, uint32_t bg);
 void vesa_set_fg_color(uint32_t fg);
 void vesa_set_bg_color(uint32_t bg);
 void vesa_set_default_color();
+void vesa_flush();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+/* Defines the dispatch table for the libc routines that have CPU specific variants.
+ * The table starts out pointing at the baseline variants and is patched once at boot. */
+#ifndef _DISPATCH_H
+#define _DISPATCH_H
+
+/* includes */
+#include <stddef.h>
+#include <stdint.h>
+
+/* defines */
+
+/* structs */
+struct dispatch_table {
+    void *(*memcpy)(void *dest, const void *src, size_t n);
+    void *(*memset)(void *dest, int c, size_t n);
+    void *(*memset32)(void *dest, uint32_t val, size_t n);
+    size_t (*strlen)(const char *str);
+};
+
+/* typedefs */
+
+/* globals */
+extern struct dispatch_table dispatch;
+
+/* functions */
+
+/* initialization functions */
+void init_dispatch();
+
+/* memcpy variants */
+void *memcpy_base(void *dest, const void *src, size_t n);
+void *memcpy_erms(void *dest, const void *src, size_t n);
+void *memcpy_sse2(void *dest, const void *src, size_t n);
+void *memcpy_avx(void *dest, const void *src, size_t n);
+
+/* memset variants */
+void *memset_base(void *dest, int c, size_t n);
+void *memset_erms(void *dest, int c, size_t n);
+void *memset_sse2(void *dest, int c, size_t n);
+void *memset_avx(void *dest, int c, size_t n);
+
+/* memset32 variants */
+void *memset32_base(void *dest, uint32_t val, size_t n);
+void *memset32_sse2(void *dest, uint32_t val, size_t n);
+void *memset32_avx(void *dest, uint32_t val, size_t n);
+
+/* strlen variants */
+size_t strlen_base(const char *str);
+size_t strlen_sse2(const char *str);
+
+#endif
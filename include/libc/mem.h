@@ -5,6 +5,7 @@
 
 /* includes */
 #include <stddef.h>
+#include <stdint.h>
 
 /* defines */
 
@@ -17,5 +18,6 @@ extern int memcmp(const void *p1, const void *p2, size_t n);
 extern void *memcpy(void *dest, const void *src, size_t n);
 extern void *memmove(void *dest, const void *src, size_t n);
 extern void *memset(void *dest, int c, size_t n);
+extern void *memset32(void *dest, uint32_t val, size_t n);
 
 #endif
\ No newline at end of file
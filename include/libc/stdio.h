@@ -3,6 +3,8 @@
 #define _STDIO_H
 
 /* includes */
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "../../drivers/vga.h"
 #include <stream.h>
@@ -32,6 +34,8 @@ extern void kprintln(char *string);
 extern int printf(const char *string, ...);
 extern int kprintf(const char *string, ...);
 extern int sprintf(char *str, const char *format, ...);
+extern int snprintf(char *str, size_t size, const char *format, ...);
+extern int vsnprintf(char *str, size_t size, const char *format, va_list args);
 
 #endif
 
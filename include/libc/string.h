@@ -4,7 +4,13 @@
 
 /* includes */
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
 /* defines */
+#define UTOA_BUF_SIZE 11    // 10 digits of a 32 bit number and a null terminator
+#define U64TOA_BUF_SIZE 21  // 20 digits of a 64 bit number and a null terminator
+#define HEX_BUF_SIZE 17     // 16 hex digits of a 64 bit number and a null terminator
 
 /* structs */
 
@@ -21,6 +27,11 @@ extern char *strtok(char *str, const char*delimeter);
 extern char *strpbrk(const char *str1, const char *str2);
 extern char *strcat(char *dest, const char *src);
 extern char *strncat(char *dest, const char *src, size_t num);
+extern size_t utoa(uint32_t val, char *buf);
+extern size_t ultoa(unsigned long val, char *buf);
+extern size_t u64toa(uint64_t val, char *buf);
+extern size_t utohex(uint32_t val, char *buf, bool upper);
+extern size_t u64tohex(uint64_t val, char *buf, bool upper);
 extern char *int_to_string(int n);
 extern char *int_to_hexstring(int n);
 extern void reverse(char *src);
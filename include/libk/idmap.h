@@ -0,0 +1,39 @@
+/* Defines the id map, which allocates integer ids and maps each allocated id to an object. */
+#ifndef _IDMAP_H
+#define _IDMAP_H
+
+/* includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* defines */
+#define IDMAP_WORD_BITS 32
+
+/* structs */
+struct id_map {
+    uint32_t *used;     // bit set when the id is allocated
+    uint32_t *full;     // bit set when the corresponding word of used is all ones
+    void **objs;        // object mapped to each allocated id
+    size_t capacity;    // number of ids in the map, a multiple of IDMAP_WORD_BITS
+    size_t count;       // number of allocated ids
+};
+
+/* typedefs */
+typedef struct id_map idmap_t;
+
+/* functions */
+
+/* init functions */
+int idmap_init(idmap_t *m, size_t capacity);
+
+/* id functions */
+int32_t idmap_alloc(idmap_t *m, void *obj);
+int idmap_free(idmap_t *m, uint32_t id);
+
+/* lookup functions */
+void *idmap_get(idmap_t *m, uint32_t id);
+bool idmap_test(idmap_t *m, uint32_t id);
+size_t idmap_count(idmap_t *m);
+
+#endif
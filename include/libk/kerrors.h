@@ -49,6 +49,8 @@
 #define LOCK_ACQ_SUCC 0
 #define LOCK_REL_FAIL 3
 #define LOCK_REL_SUCC 0
+#define WAIT_SUCC 0
+#define WAIT_TIMEOUT 4
 
 /* terminal errors */
 #define TERM_SUCC 0
@@ -69,6 +71,27 @@
 #define SLAB_FREE_FAIL 1
 #define SLAB_INIT_FAIL 2
 
+/* id map errors */
+#define IDMAP_SUCC 0
+#define IDMAP_INIT_FAIL 1
+#define IDMAP_FULL 2
+#define IDMAP_FREE_FAIL 3
+
+/* framebuffer errors */
+#define FB_SUCC 0
+#define FB_UNSUPPORTED 1
+
+/* bmp errors */
+#define BMP_SUCC 0
+#define BMP_UNSUPPORTED 1
+#define BMP_ALLOC_FAIL 2
+
+/* stream errors */
+#define STREAM_SUCC 0
+#define STREAM_RESIZE_FAIL 1
+#define STREAM_WOULD_BLOCK 2
+#define STREAM_TIMEOUT 3
+
 /* structs */
 
 /* typedefs */
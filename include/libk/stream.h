@@ -4,21 +4,37 @@
 
 /* includes */
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "synch.h"
 
 /* defines */
-#define STD_STREAM_SIZE 256
+#define STD_STREAM_SIZE 256 // default size of a std_stream, must be a power of 2
+#define CHAR_STREAM_MIN_SIZE 2   // smallest char_stream, holds one char
 
 /* structs */
+
+/* in and out are indexes into stream, one slot is always left empty
+ * so in == out means the stream is empty */
 struct CHAR_STREAM {
     char *stream;
     size_t size;
     size_t in, out;
 };
 
+/* in and out count up forever and are masked to index stream,
+ * so in - out is always the number of chars in the stream */
 struct STD_STREAM {
-    char stream[STD_STREAM_SIZE];
-    size_t size;
+    char *stream;
+    size_t size;    // always a power of 2
+    size_t mask;    // size - 1
     size_t in, out;
+
+    wait_queue_t readers;   // threads blocked in stream_read_wait
+    wait_queue_t writers;   // threads blocked in stream_write_wait
+    bool nonblock;          // stream_read_wait never blocks when set
+    bool backpressure;      // puts_std waits for space instead of dropping chars
+    bool closed;            // an end was closed, waiting reads return 0 once empty
 };
 
 /* typedefs */
@@ -33,11 +49,16 @@ void flush_c(char_stream *stream);
 int put_c(char_stream *stream, char c);
 char *get_copy_c(char_stream *stream);
 char get_c(char_stream *stream);
-void resize_c(char_stream *stream, size_t size);
+int resize_c(char_stream *stream, size_t size);
 void destroy_c(char_stream *stream);
+size_t count_c(char_stream *stream);
+size_t snapshot_c(char_stream *stream, char *buf, size_t n);
 
 /* std_stream functions */
 std_stream *init_std(std_stream *stream);
+std_stream *init_std_size(std_stream *stream, size_t size);
+int resize_std(std_stream *stream, size_t size);
+void destroy_std(std_stream *stream);
 void flush_std(std_stream *stream);
 int put_std(std_stream *stream, char c);
 int puts_std(std_stream *stream, char *s);
@@ -45,4 +66,22 @@ char *get_copy_std(std_stream *stream);
 char get_std(std_stream *stream);
 char peek_std(std_stream *stream);
 
+/* std_stream bulk functions */
+size_t stream_write(std_stream *stream, const char *buf, size_t n);
+size_t stream_read(std_stream *stream, char *buf, size_t n);
+size_t stream_count(std_stream *stream);
+size_t stream_space(std_stream *stream);
+
+/* std_stream zero-copy functions */
+void stream_peek_read(std_stream *stream, const char **ptr, size_t *len);
+void stream_commit_read(std_stream *stream, size_t n);
+void stream_reserve_write(std_stream *stream, char **ptr, size_t *len);
+void stream_commit_write(std_stream *stream, size_t n);
+
+/* std_stream blocking functions */
+int stream_read_wait(std_stream *stream, char *buf, size_t n, uint32_t timeout);
+size_t stream_write_wait(std_stream *stream, const char *buf, size_t n);
+void stream_set_nonblock(std_stream *stream, bool nonblock);
+void stream_close(std_stream *stream);
+
 #endif
\ No newline at end of file
@@ -20,9 +20,15 @@ struct semaphore {
     list_t waiters;
 };
 
+/* threads sleeping on a condition, linked by their wait_node */
+struct wait_queue {
+    list_t waiters;
+};
+
 /* typedefs */
 typedef struct semaphore semaphore_t;
 typedef struct spin_lock spin_lock_t;
+typedef struct wait_queue wait_queue_t;
 
 /* functions */
 
@@ -37,4 +43,10 @@ int spin_lock_init(spin_lock_t *sl);
 int spin_lock_acquire(spin_lock_t *sl);
 int spin_lock_release(spin_lock_t *sl);
 
+/* wait queue functions */
+void wait_queue_init(wait_queue_t *wq);
+int wait_queue_sleep(wait_queue_t *wq, uint32_t timeout);
+bool wait_queue_wake_one(wait_queue_t *wq);
+void wait_queue_wake_all(wait_queue_t *wq);
+
 #endif
\ No newline at end of file
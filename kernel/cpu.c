@@ -0,0 +1,164 @@
+/* Detects CPU features with CPUID and enables the ones the kernel uses.
+ * The results are used by libc to pick the variants of its hot routines. */
+
+/* includes */
+#include <stdint.h>
+#include <stdbool.h>
+#include "cpu.h"
+
+/* defines */
+#define EFLAGS_ID (1 << 21)
+
+#define CPUID1_EDX_SSE (1 << 25)
+#define CPUID1_EDX_SSE2 (1 << 26)
+#define CPUID1_ECX_SSSE3 (1 << 9)
+#define CPUID1_ECX_XSAVE (1 << 26)
+#define CPUID1_ECX_AVX (1 << 28)
+#define CPUID7_EBX_ERMS (1 << 9)
+
+#define CR0_MP (1 << 1)
+#define CR0_EM (1 << 2)
+#define CR4_OSFXSR (1 << 9)
+#define CR4_OSXMMEXCPT (1 << 10)
+#define CR4_OSXSAVE (1 << 18)
+
+#define XCR0_X87 (1 << 0)
+#define XCR0_SSE (1 << 1)
+#define XCR0_AVX (1 << 2)
+
+/* globals */
+static uint32_t features = 0;
+
+/* prototypes */
+static bool cpuid_supported();
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx);
+static void enable_sse();
+static bool enable_avx();
+
+/* functions */
+
+/* initialization functions */
+
+/** detects the features of the CPU and enables the ones the kernel uses
+ * should be called before anything that depends on cpu_has()
+ */
+void init_cpu() {
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t max_leaf;
+
+    if (!cpuid_supported())
+        return;
+    
+    cpuid(0, 0, &max_leaf, &ebx, &ecx, &edx);
+    if (max_leaf < 1)
+        return;
+    
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    if (edx & CPUID1_EDX_SSE)
+        features |= CPU_FEAT_SSE;
+    if (edx & CPUID1_EDX_SSE2)
+        features |= CPU_FEAT_SSE2;
+    if (ecx & CPUID1_ECX_SSSE3)
+        features |= CPU_FEAT_SSSE3;
+
+    if (features & CPU_FEAT_SSE)
+        enable_sse();
+    
+    // AVX is only usable once the ymm state is enabled in XCR0
+    if ((features & CPU_FEAT_SSE) && (ecx & CPUID1_ECX_XSAVE) && (ecx & CPUID1_ECX_AVX) && enable_avx())
+        features |= CPU_FEAT_AVX;
+
+    if (max_leaf >= 7) {
+        cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+        if (ebx & CPUID7_EBX_ERMS)
+            features |= CPU_FEAT_ERMS;
+    }
+}
+
+/* feature functions */
+
+/** checks whether the CPU supports all of the given features
+ * 
+ * @param f: bitwise or of CPU_FEAT_* values
+ * 
+ * @return true if every feature in f is supported and enabled, false otherwise
+ */
+bool cpu_has(uint32_t f) {
+    return (features & f) == f;
+}
+
+/** gets all of the detected CPU features
+ * 
+ * @return bitwise or of the supported CPU_FEAT_* values
+ */
+uint32_t cpu_get_features() {
+    return features;
+}
+
+/* static functions */
+
+/** checks whether the cpuid instruction exists by trying to flip the ID bit of EFLAGS
+ * 
+ * @return true if cpuid is supported, false otherwise
+ */
+static bool cpuid_supported() {
+    uint32_t before, after;
+    asm volatile("pushfl\n\t"
+                 "popl %0\n\t"
+                 "movl %0, %1\n\t"
+                 "xorl %2, %1\n\t"
+                 "pushl %1\n\t"
+                 "popfl\n\t"
+                 "pushfl\n\t"
+                 "popl %1\n\t"
+                 "pushl %0\n\t"
+                 "popfl"
+                 : "=&r" (before), "=&r" (after) : "i" (EFLAGS_ID) : "cc");
+    return ((before ^ after) & EFLAGS_ID) != 0;
+}
+
+/** executes cpuid
+ * 
+ * @param leaf: value of eax to execute cpuid with
+ * @param subleaf: value of ecx to execute cpuid with
+ * @param eax: where to store eax
+ * @param ebx: where to store ebx
+ * @param ecx: where to store ecx
+ * @param edx: where to store edx
+ */
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx) {
+    asm volatile("cpuid" : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx) : "a" (leaf), "c" (subleaf));
+}
+
+/** enables SSE instructions, without this they cause an invalid opcode exception */
+static void enable_sse() {
+    uint32_t cr;
+
+    asm volatile("mov %%cr0, %0" : "=r" (cr));
+    cr &= ~CR0_EM;
+    cr |= CR0_MP;
+    asm volatile("mov %0, %%cr0" : : "r" (cr));
+
+    asm volatile("mov %%cr4, %0" : "=r" (cr));
+    cr |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    asm volatile("mov %0, %%cr4" : : "r" (cr));
+}
+
+/** enables AVX instructions by turning on XSAVE and the AVX state in XCR0
+ * 
+ * @return true if the AVX state was enabled, false otherwise
+ */
+static bool enable_avx() {
+    uint32_t cr, lo, hi;
+
+    asm volatile("mov %%cr4, %0" : "=r" (cr));
+    cr |= CR4_OSXSAVE;
+    asm volatile("mov %0, %%cr4" : : "r" (cr));
+
+    asm volatile("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+    lo |= XCR0_X87 | XCR0_SSE | XCR0_AVX;
+    asm volatile("xsetbv" : : "a" (lo), "d" (hi), "c" (0));
+
+    asm volatile("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+    return (lo & (XCR0_SSE | XCR0_AVX)) == (XCR0_SSE | XCR0_AVX);
+}
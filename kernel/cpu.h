@@ -0,0 +1,49 @@
+/* Declares functions for detecting and enabling CPU features. */
+#ifndef _CPU_H
+#define _CPU_H
+
+/* includes */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* defines */
+#define CPU_FEAT_SSE (1 << 0)
+#define CPU_FEAT_SSE2 (1 << 1)
+#define CPU_FEAT_SSSE3 (1 << 2)
+#define CPU_FEAT_AVX (1 << 3)
+#define CPU_FEAT_ERMS (1 << 4)   // enhanced rep movsb/stosb
+
+/* structs */
+
+/* typedefs */
+
+/* functions */
+
+/* initialization functions */
+void init_cpu();
+
+/* feature functions */
+bool cpu_has(uint32_t features);
+uint32_t cpu_get_features();
+
+/** saves EFLAGS and disables interrupts, for sections that must not be preempted
+ * e.g. keeping SSE/AVX registers from being live across a context switch,
+ * since switch_threads doesn't save them
+ * 
+ * @return saved EFLAGS, to be given to cpu_irq_restore
+ */
+static inline uint32_t cpu_irq_save() {
+    uint32_t flags;
+    asm volatile("pushfl; popl %0; cli" : "=r" (flags) : : "memory");
+    return flags;
+}
+
+/** restores EFLAGS saved by cpu_irq_save, reenabling interrupts if they were enabled
+ * 
+ * @param flags: EFLAGS returned by cpu_irq_save
+ */
+static inline void cpu_irq_restore(uint32_t flags) {
+    asm volatile("pushl %0; popfl" : : "r" (flags) : "memory", "cc");
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include "../drivers/serial.h"
 #include "isr.h"
 #include "port_io.h"
+#include "thread.h"
 
 /* defines */
 
@@ -43,6 +44,12 @@ char *exception_messages[] = {
 
 isr_frame interrupt_handlers[IDT_SIZE];
 
+/* interrupt stack data
+ * IRQs switch to this stack in irq_common_stub so thread stacks don't need headroom for them.
+ * It is aligned like a thread stack so get_running() can recognize it */
+uint8_t irq_stack[IRQ_STACK_SIZE] __attribute__ ((aligned (STACK_ALIGN)));
+uint32_t irq_depth = 0;     // number of IRQs currently being handled
+
 /* functions */
 
 /** sets up an interrupt vector in the IDT with handler at handler_addr
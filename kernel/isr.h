@@ -8,6 +8,7 @@
 
 /* defines */
 #define IDT_SIZE 256
+#define IRQ_STACK_SIZE 4096  // must be no larger than STACK_ALIGN in thread.h
 
 /* for ease of use accessing hardware interrupts */
 #define IRQ00 32
@@ -81,6 +82,10 @@ extern void irq13();
 extern void irq14();
 extern void irq15();
 
+/* dedicated interrupt stack, the first word holds the interrupted thread */
+extern uint8_t irq_stack[];
+extern uint32_t irq_depth;
+
 /* structs */
 
 /* struct for data pushed during an isr */
@@ -9,6 +9,7 @@
 isr_common_stub:
     ; 1. Save CPU state
 	pusha           ; Pushes edi,esi,ebp,esp,ebx,edx,ecx,eax
+	cld             ; Handlers expect the direction flag to be clear
 	mov ax, ds      ; Lower 16-bits of eax = ds.
 	push eax        ; save the data segment descriptor
 	mov ax, 0x10    ; kernel data segment descriptor
@@ -33,10 +34,20 @@ isr_common_stub:
 	add esp, 8      ; Cleans up the pushed error code and pushed ISR number
 	iret            ; pops 5 things at once: CS, EIP, EFLAGS, SS, and ESP
 
-; Common IRQ code. Identical to ISR code except for the 'call' 
-; and the 'pop ebx'
+; Common IRQ code. Saves state like the ISR code, but runs the C handler
+; on the dedicated interrupt stack instead of the interrupted thread's stack.
+; Only the outermost IRQ switches stacks, nested IRQs stay on the irq stack.
+; Preemption is deferred until we are back on the thread stack.
+THREAD_STACK_ALIGN equ 32768   ; must match STACK_ALIGN in thread.h
+IRQ_STACK_SIZE equ 4096        ; must match IRQ_STACK_SIZE in isr.h
+
+[extern irq_stack]
+[extern irq_depth]
+[extern thread_preempt]
+
 irq_common_stub:
     pusha 
+    cld                         ; memmove copies backwards with the direction flag set
     mov ax, ds
     push eax
     mov ax, 0x10
@@ -44,9 +55,22 @@ irq_common_stub:
     mov es, ax
     mov fs, ax
     mov gs, ax
-    push esp
+    mov ebx, esp                        ; ebx = register frame, survives the call
+    inc dword [irq_depth]
+    cmp dword [irq_depth], 1
+    jne .on_irq_stack                   ; nested IRQ, already on the irq stack
+    mov eax, esp
+    and eax, ~(THREAD_STACK_ALIGN - 1)  ; thread_info of the interrupted thread
+    mov [irq_stack], eax                ; base of irq stack records who we interrupted
+    mov esp, irq_stack + IRQ_STACK_SIZE
+.on_irq_stack:
+    push ebx
     call irq_handler    ; Different than the ISR code
-    pop eax
+    mov esp, ebx        ; back onto the stack we were interrupted on
+    dec dword [irq_depth]
+    jnz .restore        ; don't preempt from inside a nested IRQ
+    call thread_preempt
+.restore:
     pop ebx             ; Different than the ISR code
     mov ds, bx
     mov es, bx
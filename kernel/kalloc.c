@@ -81,6 +81,33 @@ void *palloc_mult(size_t cnt) {
     return NULL;
 }
 
+/** gets the address of cnt consecutive free pages whose first page is aligned to align pages
+ * 
+ * @param cnt: number of consecutive pages to allocate
+ * @param align: alignment of the region in pages, must divide the 4 MB start of palloc memory
+ * 
+ * @return address of allocated region, NULL if region doesn't exist
+ */
+void *palloc_aligned(size_t cnt, size_t align) {
+    if (align == 0)
+        align = 1;
+
+    if (spin_lock_acquire(&palloc_lock) != LOCK_ACQ_SUCC)
+        return NULL;
+    
+    size_t idx;
+    for (idx = 0; idx + cnt <= bitmap_get_size(&free_map); idx += align) {
+        if (bitmap_count_range(&free_map, idx, cnt) == 0) {
+            bitmap_set_range(&free_map, idx, cnt, true);
+            spin_lock_release(&palloc_lock);
+            return (void *) (start_addr + (idx * PG_SIZE));
+        }
+    }
+    
+    spin_lock_release(&palloc_lock);
+    return NULL;
+}
+
 /** frees a page of memory obtained from palloc
  * 
  * @param addr: address of previous allocation to free
@@ -23,6 +23,7 @@ void init_alloc(multiboot_info_t *mb);
 /* page allocation functions */
 void *palloc();
 void *palloc_mult(size_t cnt);
+void *palloc_aligned(size_t cnt, size_t align);
 int pfree(void *addr);
 int pfree_mult(void *addr, size_t cnt);
 
@@ -6,6 +6,7 @@
 
 /* libc */
 #include <stdio.h>
+#include <dispatch.h>
 
 /* Boot */
 #include "../boot/multiboot.h"
@@ -27,6 +28,9 @@
 /* Interrupts */
 #include "isr.h"
 
+/* CPU */
+#include "cpu.h"
+
 /* Testing */
 #ifdef TESTS
     #include "../testing/tests.h"
@@ -42,8 +46,33 @@ bmp_file_header_t header;
 /* Summary of version changes:
  * 0.4.0: Added a serial driver in, as well as process features.
  * 0.4.1: Moved print_logo to only run on start in kernel .c
+ * 0.4.2: IRQs run on a dedicated interrupt stack and preempt after switching back
+ * 0.4.3: Thread stacks can be multiple pages and are checked for overflow on switches
+ * 0.4.4: Freed thread stacks are cached in a bounded pool
+ * 0.4.5: Added an id map for tids/pids with constant time lookups, tids are now freed
+ * 0.4.6: Dying threads are freed in batches by a reaper thread instead of on every switch
+ * 0.4.7: Detect CPU features, memcpy/memmove/memset use string instructions and SSE2
+ * 0.4.8: memcpy, memset, strlen and VESA fills pick SSE2/AVX/ERMS variants at boot
+ * 0.4.9: String search and compare functions work a word at a time
+ * 0.4.10: printf family shares a buffered vsnprintf core and writes once per call
+ * 0.4.11: Reentrant table-driven integer to string conversions
+ * 0.4.12: std_streams are power of 2 sized, resizable and support bulk reads/writes
+ * 0.4.13: Stream reads can block on a wait queue with a timeout, so the idle shell sleeps
+ * 0.4.14: Pipes with backpressure connect processes, and the shell runs "|" pipelines
+ * 0.4.15: char_streams grow on demand and keep their contents in order when resized
+ * 0.4.16: std_streams can lend their ring memory to readers and writers without copying
+ * 0.4.17: VESA draws to a backbuffer in RAM and flushes dirty rectangles once a frame
+ * 0.4.18: Console text is a ring of cells, so scrolling bumps a head instead of moving pixels
+ * 0.4.19: Glyph rows are drawn from a byte to pixel lookup table, one copy per row
+ * 0.4.20: Framebuffers of 16, 24 and 32 bits per pixel with any pitch and channel layout work
+ * 0.4.21: The display interface fills, blits and copies rectangles, and clearing, scrolling and the logo use them
+ * 0.4.22: BMP images are decoded once and recolored through their palette, 8-bit and RLE8 images work and the logo is RLE8
+ * 0.4.23: Four virtual consoles, each with its own shell, switched with Alt+F1 to Alt+F4
+ * 0.4.24: The terminal interprets VT100 escape sequences and draws the text between them in one batch
+ * 0.4.25: The cursor is an overlay drawn at flush time and blinked by the display refresh thread
+ * 0.4.26: Each console keeps a scrollback ring paged through with Shift+PgUp/PgDn
  */
-char *version_no = "0.4.1";
+char *version_no = "0.4.26";
 
 #ifndef TESTS
 static void print_logo();
@@ -56,6 +85,8 @@ static void print_logo();
  * @param magic: unused
  */
 void kmain(multiboot_info_t *mbi, unsigned int magic __attribute__ ((unused))) {
+    init_cpu();
+    init_dispatch();
     init_idt();
     init_alloc(mbi);
     init_processes();
@@ -88,7 +119,7 @@ static void print_logo() {
     read_bmp_header(header_addr, &header);
     bmp_change_color(&header, 0xFFFFFF, 0x0);
     get_default_dis_driver()->dis_clear();
-    draw_bmp_data(&header, 10, vesa_get_cursor_y() * FONT_HEIGHT + 10);
+    get_default_dis_driver()->dis_draw(&header, 10, vesa_get_cursor_y() * FONT_HEIGHT + 10);
     get_default_dis_driver()->dis_setcur(0, (header.info_header.height / FONT_HEIGHT) + 1);
 }
 #endif
\ No newline at end of file
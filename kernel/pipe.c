@@ -0,0 +1,64 @@
+/* Implements pipes. A pipe is a std_stream with backpressure, so a writer blocks while
+ * the pipe is full and the reader blocks while it is empty, letting both ends run
+ * concurrently. Closing either end wakes the other one up. */
+
+/* includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stream.h>
+#include "pipe.h"
+#include "kalloc.h"
+#include "cpu.h"
+
+/* defines */
+
+/* globals */
+
+/* prototypes */
+
+/* functions */
+
+/** creates a pipe with both ends open
+ * 
+ * @param size: capacity of the pipe, rounded up to a power of 2,
+ *              0 for PIPE_DEFAULT_SIZE
+ * 
+ * @return pointer to the new pipe, NULL on failure
+ */
+struct pipe *pipe_create(size_t size) {
+    struct pipe *pipe = (struct pipe *) kmalloc(sizeof(struct pipe));
+    if (pipe == NULL)
+        return NULL;
+    
+    if (init_std_size(&pipe->stream, size == 0 ? PIPE_DEFAULT_SIZE : size) == NULL) {
+        kfree(pipe);
+        return NULL;
+    }
+
+    pipe->stream.backpressure = true;
+    pipe->open_ends = PIPE_ENDS;
+
+    return pipe;
+}
+
+/** closes one end of a pipe
+ * closing the write end lets the reader drain the pipe and then read 0,
+ * closing the read end makes blocked writers return early
+ * 
+ * @param pipe: pipe to close an end of, freed once both ends are closed
+ */
+void pipe_close(struct pipe *pipe) {
+    if (pipe == NULL)
+        return;
+
+    uint32_t flags = cpu_irq_save();
+    stream_close(&pipe->stream);
+    bool last = --pipe->open_ends == 0;
+    cpu_irq_restore(flags);
+
+    if (last) {
+        destroy_std(&pipe->stream);
+        kfree(pipe);
+    }
+}
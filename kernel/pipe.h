@@ -0,0 +1,26 @@
+/* Defines pipes, which connect the stdout of one process to the stdin of another. */
+#ifndef _PIPE_H
+#define _PIPE_H
+
+/* includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <stream.h>
+
+/* defines */
+#define PIPE_DEFAULT_SIZE 4096  // default capacity of a pipe, must be a power of 2
+#define PIPE_ENDS 2
+
+/* structs */
+
+/* a pipe is freed once both its write and read ends are closed */
+struct pipe {
+    std_stream stream;
+    uint8_t open_ends;
+};
+
+/* functions */
+struct pipe *pipe_create(size_t size);
+void pipe_close(struct pipe *pipe);
+
+#endif
@@ -8,10 +8,12 @@
 #include <string.h>
 #include <kerrors.h>
 #include <list.h>
+#include <idmap.h>
 #include <mem.h>
 #include "../drivers/vesa.h"
 #include "proc.h"
 #include "kalloc.h"
+#include "cpu.h"
 
 /* defines */
 
@@ -19,10 +21,11 @@
 static struct list all_procs;
 static struct process *current;
 static struct process *active;
-static uint32_t pid_count;
+static idmap_t pids;    // maps pids to their processes
 
 /* prototypes */
 static int proc_get_free_thread(struct process *proc);
+static void proc_destroy_std(struct process *proc);
 
 /* functions */
 
@@ -31,6 +34,7 @@ static int proc_get_free_thread(struct process *proc);
 /** initializes the process subsystem */
 void init_processes() {
     list_init(&all_procs);
+    idmap_init(&pids, MAX_PID);
 
     //create init process
     struct process *p = (struct process *) palloc();
@@ -41,20 +45,21 @@ void init_processes() {
         asm volatile("hlt");
     }
 
-    init_std(&p->std_in);
-    init_std(&p->std_out);
-    init_std(&p->std_err);
-    flush_std(&p->std_in);
-    flush_std(&p->std_out);
-    flush_std(&p->std_err);
+    if (init_std(&p->std_in) == NULL || init_std(&p->std_out) == NULL || init_std(&p->std_err) == NULL) {
+        char *stop = NULL;
+        *stop = 0;
+        asm volatile("cli");
+        asm volatile("hlt");
+    }
 
     p->stdin = &p->std_in;
     p->stdout = &p->std_out;
     p->stderr = &p->std_err;
+    p->pipe_in = p->pipe_out = NULL;
+    p->console = 0;
 
     sprintf(p->name, "init");
-    pid_count = 0;
-    p->pid = pid_count++;
+    p->pid = idmap_alloc(&pids, p);
 
     int i;
     for (i = 0; i < MAX_NUM_THREADS; i++)
@@ -64,6 +69,8 @@ void init_processes() {
 
     list_init(&p->waiters);
     p->wait_code = 0;
+    p->dead = false;
+    p->refs = 1;
 
     init_threads(p);
     p->active_thread = p->threads[0];
@@ -79,9 +86,26 @@ void init_processes() {
  * @param func: function for the main thread of the process to execute
  * @param aux: parameters for func and any other data
  * 
- * @return -PROC_CREATE_FAIL on failure, pid of proc otherwise
+ * @return NULL on failure, pointer to the new process otherwise
  */
 struct process *proc_create(char *name, proc_function func, void *aux) {
+    return proc_create_piped(name, func, aux, NULL, NULL);
+}
+
+/** creates a process with pipes as its stdin and/or stdout
+ * the pipes are connected before the process starts running, and the process
+ * closes its ends of them when it dies
+ * 
+ * @param name: name of the process
+ * @param func: function for the main thread of the process to execute
+ * @param aux: parameters for func and any other data
+ * @param in: pipe to read stdin from, NULL to use the process' own stdin
+ * @param out: pipe to write stdout to, NULL to use the process' own stdout
+ * 
+ * @return NULL on failure, in which case the caller still owns the pipe ends,
+ *         pointer to the new process otherwise
+ */
+struct process *proc_create_piped(char *name, proc_function func, void *aux, struct pipe *in, struct pipe *out) {
     //change this to just use kmalloc
     struct process *p = (struct process *) palloc();
     if (p == NULL)
@@ -89,33 +113,46 @@ struct process *proc_create(char *name, proc_function func, void *aux) {
     
     sprintf(p->name, "%s", name);
 
-    p->pid = pid_count++;
-
-    init_std(&p->std_in);
-    init_std(&p->std_out);
-    init_std(&p->std_err);
-    flush_std(&p->std_in);
-    flush_std(&p->std_out);
-    flush_std(&p->std_err);
+    int32_t pid = idmap_alloc(&pids, p);
+    if (pid < 0) {
+        pfree(p);
+        return NULL;
+    }
+    p->pid = pid;
+
+    // streams that weren't initialized have no buffer for proc_destroy_std to free
+    p->std_in.stream = p->std_out.stream = p->std_err.stream = NULL;
+    if (init_std(&p->std_in) == NULL || init_std(&p->std_out) == NULL || init_std(&p->std_err) == NULL) {
+        proc_destroy_std(p);
+        idmap_free(&pids, p->pid);
+        pfree(p);
+        return NULL;
+    }
     
-    p->stdin = &p->std_in;
-    p->stdout = &p->std_out;
+    p->stdin = in != NULL ? &in->stream : &p->std_in;
+    p->stdout = out != NULL ? &out->stream : &p->std_out;
     p->stderr = &p->std_err;
+    p->pipe_in = in;
+    p->pipe_out = out;
+    p->console = PROC_CUR()->console;
 
     int i;
-    for (i = 0; i < MAX_NUM_THREADS; i++) {
-        p->threads[i]->state = THREAD_TERMINATED;
-        p->threads[i]->child_num = i;
-    }
+    for (i = 0; i < MAX_NUM_THREADS; i++)
+        p->threads[i] = NULL;
 
     list_init(&p->waiters);
     p->wait_code = 0;
+    p->dead = false;
+    p->refs = 1;
 
     p->magic = PROC_MAGIC;
 
     if (thread_create(0, "main", p, 0, func, aux) != -THREAD_CREATE_FAIL)
         p->num_live_threads = 1;
     else {
+        proc_destroy_std(p);
+        idmap_free(&pids, p->pid);
+        pfree(p);
         return NULL;
     }
     
@@ -191,6 +228,30 @@ int proc_wait(struct process *p) {
     return p->wait_code;
 }
 
+/** holds a reference to a process, so it isn't freed when it dies until the reference is released
+ * the pointer stays valid even after the pid is reused
+ * 
+ * @param p: process to hold a reference to
+ */
+void proc_hold(struct process *p) {
+    uint32_t flags = cpu_irq_save();
+    p->refs++;
+    cpu_irq_restore(flags);
+}
+
+/** releases a reference to a process, freeing the process once the last reference is released
+ * 
+ * @param p: process to release a reference to
+ */
+void proc_release(struct process *p) {
+    uint32_t flags = cpu_irq_save();
+    bool last = --p->refs == 0;
+    cpu_irq_restore(flags);
+
+    if (last)
+        pfree(p);
+}
+
 /** cleans up any book keeping for process p
  * the actual resources should be deallocated in thread_kill
  * 
@@ -200,8 +261,17 @@ void proc_cleanup(struct process *p) {
     if (p == NULL || p->num_live_threads != 0) 
         return;
 
+    // free the pid first, so a thread can't look p up after its waiters are notified
+    uint32_t flags = cpu_irq_save();
+    idmap_free(&pids, p->pid);
+    p->dead = true;
     proc_notify(p, true, 0);
+    cpu_irq_restore(flags);
+
     list_delete(&all_procs, &p->node);
+    pipe_close(p->pipe_in);
+    pipe_close(p->pipe_out);
+    proc_destroy_std(p);
 }
 
 /** kill a process
@@ -252,18 +322,10 @@ void proc_set_active_thread(struct process *proc, uint8_t num) {
  * @param pid: pid of process to set as active
  */
 void proc_set_active(uint32_t pid) {
-    list_node_t *node = all_procs.head.next;
-    struct process *proc = LIST_ENTRY(node, struct process, node);
-
-    while (list_hasNext(node)) {
-        if (proc != NULL && proc->pid == pid) {
-            active = proc;
-            break;
-        }
+    struct process *proc = proc_get(pid);
 
-        node = node->next;
-        proc = LIST_ENTRY(node, struct process, node);
-    }
+    if (proc != NULL)
+        active = proc;
 }
 
 /** sets the active process to proc
@@ -292,6 +354,16 @@ struct process *proc_get_active() {
     return active;
 }
 
+/** gets the process with id pid
+ * 
+ * @param pid: id of the process to get
+ * 
+ * @return process with id pid, NULL if no such process exists
+ */
+struct process *proc_get(uint32_t pid) {
+    return (struct process *) idmap_get(&pids, pid);
+}
+
 /** returns a pointer to the all list for processes
  * don't use this unless necessary, shouldn't modify this list
  * 
@@ -329,6 +401,16 @@ static int proc_get_free_thread(struct process *proc) {
     return -1;
 }
 
+/** frees the buffers of the std streams of a process
+ * 
+ * @param proc: process to free the std streams of
+ */
+static void proc_destroy_std(struct process *proc) {
+    destroy_std(&proc->std_in);
+    destroy_std(&proc->std_out);
+    destroy_std(&proc->std_err);
+}
+
 
 
 
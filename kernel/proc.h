@@ -9,11 +9,13 @@
 #include <stream.h>
 #include <list.h>
 #include "thread.h"
+#include "pipe.h"
 
 
 /* defines */
 #define MAX_NUM_THREADS 8
 #define MAX_NAME_LENGTH 12
+#define MAX_PID 512
 #define PROC_MAGIC 0x34
 
 /* structs */
@@ -32,9 +34,13 @@ struct process {
     std_stream *stdout; // stdout handle 
     std_stream *stderr; // stderr handle
     std_stream std_in, std_out, std_err;   // std streams of the process
+    struct pipe *pipe_in, *pipe_out;    // pipes used as stdin/stdout, closed when the process dies
+    uint32_t console;   // virtual console the process draws to, inherited from its creator
 
     list_t waiters; // list of waiting processes
     int wait_code;  // return code of process waited on
+    bool dead;      // set once the process is cleaned up, waiting on it then would never return
+    uint32_t refs;  // references keeping the process from being freed, its own threads hold one
     list_node_t wait_node; // node to wait on processes with
 
     list_node_t node; // node for all list of processes
@@ -51,9 +57,12 @@ void init_processes();
 
 /* process state functions */
 struct process *proc_create(char *name, proc_function f, void *aux);
+struct process *proc_create_piped(char *name, proc_function f, void *aux, struct pipe *in, struct pipe *out);
 void proc_exit(int *ret);
 void proc_kill(struct process *proc, int *ret);
 int proc_wait(struct process *proc);
+void proc_hold(struct process *p);
+void proc_release(struct process *p);
 int proc_notify(struct process *proc, bool all, int ret);
 void proc_cleanup(struct process *p);
 
@@ -65,6 +74,7 @@ void proc_set_active_p(struct process *proc);
 /* process "getter" functions */
 enum thread_states proc_get_state(struct process *p);
 struct process *proc_get_active();
+struct process *proc_get(uint32_t pid);
 
 const list_node_t *proc_peek_all_list();
 uint8_t proc_get_live_t_count(struct process *proc);
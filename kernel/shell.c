@@ -5,40 +5,50 @@
 #include <stdbool.h>
 #include <string.h>
 #include <mem.h>
+#include <kerrors.h>
 #include "../drivers/terminal.h"
 #include "../drivers/bmp.h"
 #include "shell.h"
 #include "thread.h"
 #include "port_io.h"
 #include "proc.h"
+#include "pipe.h"
+#include "cpu.h"
 
 /* defines */
 #define GRAPHICS_MODE 0
 #define TEXT_MODE 1
 
 #define MAX_NUM_ARGS 26
-#define NUM_COMMANDS 8
+#define NUM_COMMANDS 9
 #define NUM_HELP_COMMANDS (NUM_COMMANDS - 2)
 
 #define LOGO_COLOR 0xBD5615
 #define MIN_ARG_MEM 16  //small strings really screw up arg-making
+#define MAX_PIPELINE_LENGTH 4   // max number of commands joined by '|'
+#define PIPE_IO_SIZE 128        // size of the buffers used to move data through pipes
+#define PS_COLUMN_WIDTH 16      // width of each column of ps but the last
+#define PS_LINE_SIZE 96         // max size of a line of ps, including the newline
 
 /* globals */
 
 /* shell info */
 size_t last_index = 0;
-char *help_commands[NUM_HELP_COMMANDS] = {"help", "shutdown", "exit", "ps", "clear", "getbuf"};
-char *commands[NUM_COMMANDS] = {"help", "shutdown", "exit", "ps", "clear", "getbuf", "grub", "moon"};
-struct process *shell;
+char *help_commands[NUM_HELP_COMMANDS] = {"help", "shutdown", "exit", "ps", "clear", "getbuf", "cat"};
+char *commands[NUM_COMMANDS] = {"help", "shutdown", "exit", "ps", "clear", "getbuf", "cat", "grub", "moon"};
+struct process *shells[NUM_CONSOLES];   // shell attached to each virtual console
 
 /* key buffer info */
-static char key_buffer[LINE_BUFFER_SIZE];
-static bool cursor_on = false;
+static char key_buffers[NUM_CONSOLES][LINE_BUFFER_SIZE];
 
 /* prototypes */
 static void shell_waiter(void *aux);
 static void read_stdin(struct process *active);
-static uint32_t ps_get_alignment(display_t *dis, uint32_t *alignment);
+static void run_pipeline(char *line);
+static int find_command(char *name);
+static uint32_t make_args(char *cmd, char **args);
+static void free_args(char **args, uint32_t argc);
+static void wait_proc(struct process *p);
 
 /* command functions */
 static void help(void *aux);
@@ -48,113 +58,244 @@ static void getbuf(void *aux);
 static void grub(void *aux);
 static void moon(void *aux);
 static void clear(void *aux);
-proc_function *command_functions[NUM_COMMANDS] = {help, shutdown, shutdown, ps, clear, getbuf, grub, moon}; // this has to be here sadly, can't be moved before the protoyypes
+static void cat(void *aux);
+proc_function *command_functions[NUM_COMMANDS] = {help, shutdown, shutdown, ps, clear, getbuf, cat, grub, moon}; // this has to be here sadly, can't be moved before the protoyypes
 
 /* functions */
 
-/** initializes a shell process */
+/** initializes a shell process for each virtual console */
 void shell_init() {
-    shell = proc_create("shell", shell_waiter, NULL);
-    proc_set_active(shell->pid);
-    shell->stdout = shell->stdin;
+    for (uint32_t i = 0; i < NUM_CONSOLES; i++) {
+        struct process *shell = proc_create("shell", shell_waiter, (void *) i);
+        shell->console = i;
+        shell->stdout = shell->stdin;
+
+        line_disc_t *ld = get_line_disc(i);
+        line_init(ld, NULL, GET_STDOUT(shell), GET_STDIN(shell), COOKED);
+        terminal_attach(ld->term, i);
+        shells[i] = shell;
+    }
 
-    line_init(get_default_line_disc(), NULL, GET_STDOUT(shell), GET_STDIN(shell), COOKED);
+    proc_set_active(shells[0]->pid);
 }
 
-/** function for the shell process to use, constantly scans input
+/** function for the shell processes to use, waits on input
+ * the kernel prints the prompt of the first console after the logo
  * 
- * @param aux: unused
+ * @param aux: number of the console of the shell
  */
-static void shell_waiter(void *aux __attribute__ ((unused))) {
-    uint32_t last_cursor_tick = 0;
-
-    while (1) {
-        if (THREAD_CUR()->ticks % 48 == 0 && THREAD_CUR()->ticks != last_cursor_tick) {
-            if (cursor_on) {
-                get_default_dis_driver()->dis_hcur();
-                cursor_on = false;
-            } else {
-                get_default_dis_driver()->dis_scur();
-                cursor_on = true;
-            }
-
-            last_cursor_tick = THREAD_CUR()->ticks;
-        }
-
-        read_stdin(shell);
-
-    }
+static void shell_waiter(void *aux) {
+    uint32_t console = (uint32_t) aux;
 
+    if (console != 0)
+        kprintf("> ");
+    get_default_dis_driver()->dis_scur();
+    
+    while (1)
+        read_stdin(shells[console]);
 }
 
 /** reads the active process' stdin stream for input from the user
+ * blocks until input arrives
  * input is executed as a command, if available, when the ENTER key is pressed
  * 
  * @param active: pointer to active process
  */ 
 static void read_stdin(struct process *active) {
-    line_disc_t *ld = get_default_line_disc();
+    line_disc_t *ld = get_line_disc(active->console);
     std_stream *stdin = GET_STDIN(active);
     display_t *dis = get_default_dis_driver();
+    char *key_buffer = key_buffers[active->console];
+
+    char c;
+    if (stream_read_wait(stdin, &c, 1, 0) <= 0)
+        return;
+
+    // scan the rest of the input for a newline in place instead of copying it out
+    bool newline = c == '\n';
+    const char *input;
+    size_t len;
+
+    stream_peek_read(stdin, &input, &len);
+    while (!newline && len > 0) {
+        newline = memchr(input, '\n', len) != NULL;
+        stream_commit_read(stdin, len);
+        stream_peek_read(stdin, &input, &len);
+    }
+
+    if (newline) {
+        dis->dis_hcur();
+        ld->line_outbufn(ld, key_buffer, LINE_BUFFER_SIZE);
+        key_buffer[strlen(key_buffer) - 1] = 0; // remove the newline
 
-    char c = get_std(stdin);
-    while (c != -1) {
-        if (c == '\n') {
-            dis->dis_hcur();
-            ld->line_outbufn(ld, key_buffer, LINE_BUFFER_SIZE);
-            key_buffer[strlen(key_buffer) - 1] = 0; // remove the newline
-
-            char *args[MAX_NUM_ARGS];
-            uint32_t argc = 0;
-            char *token = strtok(key_buffer, " ");
-            size_t arg_length = strlen(token);
-
-            args[0] = kmalloc(arg_length);
-            strcpy(args[0], token);
-            argc++;
-
-            while ((token = strtok(NULL, " ")) != NULL && argc < MAX_NUM_ARGS) {
-                arg_length = strlen(token);
-                
-                if (arg_length < MIN_ARG_MEM)
-                    arg_length = MIN_ARG_MEM;
-
-                args[argc] = kmalloc(arg_length);
-                strcpy(args[argc], token);
-                argc++;
-            }
-
-            int i;
-            for (i = 0; i < NUM_COMMANDS; i++) {
-                if (strcmp(trim(args[0]), commands[i]) == 0) {
-                    /* this should make a new process/thread, but I need to be able
-                    *  to wait on child processes  */
-
-                    void *aux[2] = {(void *) args, (void *) argc};
-                    struct process *comm = proc_create("ps", command_functions[i], aux);
-                    if (comm) {
-                        proc_wait(comm);
-                    }
-                    
-                    break;
-                }
-            }
-            flush_std(stdin);
-            ld->line_flush(ld);
-
-            for (uint32_t i = 0; i < argc; i++) {
-                memset(args[i], 0, strlen(args[i]));
-                kfree(args[i]);
-            }
-
-            memset(args, 0, MAX_NUM_ARGS * sizeof(char *));
-            memset(key_buffer, 0, LINE_BUFFER_SIZE);
-            kprintf("> ");
+        run_pipeline(key_buffer);
+        flush_std(stdin);
+        ld->line_flush(ld);
+
+        memset(key_buffer, 0, LINE_BUFFER_SIZE);
+        kprintf("> ");
+        dis->dis_scur();
+    }
+}
+
+/** runs a line of commands joined by '|', the stdout of each command is piped
+ * into the stdin of the next one and the last one's stdout is printed
+ * the commands run concurrently, and this blocks until the pipeline is done
+ * 
+ * @param line: line of commands to run, gets modified
+ */
+static void run_pipeline(char *line) {
+    char *cmds[MAX_PIPELINE_LENGTH];
+    char *args[MAX_PIPELINE_LENGTH][MAX_NUM_ARGS];
+    uint32_t argc[MAX_PIPELINE_LENGTH];
+    void *aux[MAX_PIPELINE_LENGTH][2];
+    int cmd_nums[MAX_PIPELINE_LENGTH];
+    struct process *procs[MAX_PIPELINE_LENGTH];
+    uint32_t num_cmds = 0, num_procs = 0;
+
+    cmds[num_cmds++] = line;
+    while (num_cmds < MAX_PIPELINE_LENGTH && (line = strchr(line, '|')) != NULL) {
+        *line++ = '\0';
+        cmds[num_cmds++] = line;
+    }
+
+    // only start the pipeline if every command in it exists
+    for (uint32_t i = 0; i < num_cmds; i++) {
+        argc[i] = make_args(cmds[i], args[i]);
+        cmd_nums[i] = argc[i] > 0 ? find_command(args[i][0]) : -1;
+
+        if (cmd_nums[i] < 0) {
+            if (argc[i] > 0)
+                kprintf("%s: command not found\n", args[i][0]);
+
+            for (uint32_t j = 0; j <= i; j++)
+                free_args(args[j], argc[j]);
+
+            return;
         }
-        
+    }
 
-        c = get_std(stdin);
+    // the first command reads from a pipe that's already closed, so it sees no input
+    struct pipe *in = pipe_create(1);
+    pipe_close(in);
+
+    for (uint32_t i = 0; i < num_cmds && in != NULL; i++) {
+        struct pipe *out = pipe_create(0);
+        if (out == NULL) {
+            pipe_close(in);
+            in = NULL;
+            break;
+        }
+
+        aux[i][0] = (void *) args[i];
+        aux[i][1] = (void *) argc[i];
+        // the command can't run and die before it's held while interrupts are off
+        uint32_t flags = cpu_irq_save();
+        struct process *comm = proc_create_piped(commands[cmd_nums[i]], command_functions[cmd_nums[i]], aux[i], in, out);
+        if (comm != NULL)
+            proc_hold(comm);
+        cpu_irq_restore(flags);
+
+        // nothing got the ends of out, so both are closed
+        if (comm == NULL) {
+            pipe_close(in);
+            pipe_close(out);
+            pipe_close(out);
+            in = NULL;
+            break;
+        }
+
+        procs[num_procs++] = comm;
+        in = out;
+    }
+
+    // the shell is the reader of the last pipe
+    if (in != NULL) {
+        char buf[PIPE_IO_SIZE];
+        int n;
+
+        while ((n = stream_read_wait(&in->stream, buf, PIPE_IO_SIZE - 1, 0)) > 0) {
+            buf[n] = '\0';
+            kprint(buf);
+        }
+
+        pipe_close(in);
     }
+
+    for (uint32_t i = 0; i < num_procs; i++)
+        wait_proc(procs[i]);
+
+    for (uint32_t i = 0; i < num_cmds; i++)
+        free_args(args[i], argc[i]);
+}
+
+/** finds the index of a command in the command table
+ * 
+ * @param name: name of the command
+ * 
+ * @return index of the command, -1 if there is no such command
+ */
+static int find_command(char *name) {
+    for (int i = 0; i < NUM_COMMANDS; i++)
+        if (strcmp(trim(name), commands[i]) == 0)
+            return i;
+
+    return -1;
+}
+
+/** splits a command into space separated args, each copied into its own allocation
+ * 
+ * @param cmd: command to split, gets modified
+ * @param args: array of at least MAX_NUM_ARGS strings to store the args in
+ * 
+ * @return number of args stored in args
+ */
+static uint32_t make_args(char *cmd, char **args) {
+    uint32_t argc = 0;
+    char *token = strtok(cmd, " ");
+
+    while (token != NULL && argc < MAX_NUM_ARGS) {
+        size_t arg_length = strlen(token) + 1;
+
+        if (arg_length < MIN_ARG_MEM)
+            arg_length = MIN_ARG_MEM;
+
+        args[argc] = kmalloc(arg_length);
+        if (args[argc] == NULL)
+            break;
+
+        strcpy(args[argc], token);
+        argc++;
+        token = strtok(NULL, " ");
+    }
+
+    return argc;
+}
+
+/** frees args made by make_args
+ * 
+ * @param args: args to free
+ * @param argc: number of args
+ */
+static void free_args(char **args, uint32_t argc) {
+    for (uint32_t i = 0; i < argc; i++) {
+        memset(args[i], 0, strlen(args[i]));
+        kfree(args[i]);
+    }
+}
+
+/** waits on a process held with proc_hold until it dies, and releases it
+ * 
+ * @param p: process to wait on
+ */
+static void wait_proc(struct process *p) {
+    // the process can't die between checking it and waiting on it while interrupts are off
+    uint32_t flags = cpu_irq_save();
+    if (!p->dead)
+        proc_wait(p);
+    cpu_irq_restore(flags);
+
+    proc_release(p);
 }
 
 /** prints a list of available commands
@@ -163,10 +304,10 @@ static void read_stdin(struct process *active) {
  * @param argc: unused
  */
 static void help(void *aux __attribute__ ((unused))) {
-    kprintf("Available Commands:\n");
+    printf("Available Commands:\n");
     int i;
     for (i = 0; i < NUM_HELP_COMMANDS; i++) {
-        kprintf("\t%s\n", help_commands[i]);
+        printf("\t%s\n", help_commands[i]);
     }
 }
 /** shuts down the machine gracefully (only works for qemu) 
@@ -188,10 +329,10 @@ static void getbuf(void *aux) {
     char **args = ((char **) aux_arr[0]);
     uint32_t argc = (uint32_t) (aux_arr[1]);
 
-    kprintf("buffer: ");
+    printf("buffer: ");
     for (uint32_t i = 0; i < argc; i++)
-        kprintf("%s ", args[i]);
-    kprintf("\n");
+        printf("%s ", args[i]);
+    printf("\n");
 }
 
 /** converts a thread state to a human-readable string
@@ -220,63 +361,64 @@ static char *p_state_to_string(enum thread_states s) {
 
 
 /** prints info about the processes in the system
+ * the list is formatted all at once before it's printed, since printing can block
+ * on a full pipe while the list changes
  * 
- * @param line: unused
- * @param argc: unused
+ * @param aux: unused
  */
 static void ps(void *aux __attribute__ ((unused))) {
-    display_t *dis = get_default_dis_driver();
-    const list_node_t *node = proc_peek_all_list();
-    uint32_t alignment = 0;
+    uint32_t flags = cpu_irq_save();
+    size_t num_procs = 0;
+    for (const list_node_t *node = proc_peek_all_list(); list_hasNext(node); node = list_get_next(node))
+        num_procs++;
+
+    size_t size = (num_procs + 1) * PS_LINE_SIZE;
+    char *buf = kmalloc(size);
+    if (buf == NULL) {
+        cpu_irq_restore(flags);
+        printf("ps: out of memory\n");
+        return;
+    }
 
-    char *headers[4] = {"name", "pid", "state", "active thread\n"};
-    for (int i = 0; i < 4; i++)
-        dis->dis_putats(headers[i], ps_get_alignment(dis, &alignment), dis->dis_gety());
-    
-    while (list_hasNext(node)) {
-        alignment = 0;
-        struct process *proc = LIST_ENTRY(node, struct process, node);
-        dis->dis_putats(proc->name, ps_get_alignment(dis, &alignment), dis->dis_gety());
-        dis->dis_putats(int_to_string(proc->pid), ps_get_alignment(dis, &alignment), dis->dis_gety());
-        dis->dis_putats(p_state_to_string(proc_get_state(proc)), ps_get_alignment(dis, &alignment), dis->dis_gety());
-        dis->dis_putats(proc->active_thread->name, ps_get_alignment(dis, &alignment), dis->dis_gety());
-        kprintf("\n");
+    int len = snprintf(buf, size, "%-*s%-*s%-*s%s\n", PS_COLUMN_WIDTH, "name", PS_COLUMN_WIDTH, "pid",
+                       PS_COLUMN_WIDTH, "state", "active thread");
 
-        node = list_get_next(node);
+    for (const list_node_t *node = proc_peek_all_list(); list_hasNext(node); node = list_get_next(node)) {
+        struct process *proc = LIST_ENTRY(node, struct process, node);
+        len += snprintf(buf + len, size - len, "%-*s%-*u%-*s%s\n", PS_COLUMN_WIDTH, proc->name,
+                        PS_COLUMN_WIDTH, proc->pid, PS_COLUMN_WIDTH, p_state_to_string(proc_get_state(proc)),
+                        proc->active_thread->name);
     }
+    cpu_irq_restore(flags);
 
-}
-
-/** helper function for ps that gets the y coordinate of the next info string
- * 
- * @param dis: display driver used by the shell
- * @param a: alignment used in calculation
- * 
- * @return y coordinate of next info string
- */
-static uint32_t ps_get_alignment(display_t *dis, uint32_t *a) {
-    uint32_t next_y = (*a) * (dis->dis_getn_cols() / 8);
-    *a = *a + 1;    // done this way so compiler doesn't complain
-    return next_y;
+    printf("%s", buf);
+    kfree(buf);
 }
 
 static void clear(void *aux __attribute__ ((unused))) {
     get_default_dis_driver()->dis_clear();
 }
 
+/** copies stdin to stdout until stdin is closed
+ * 
+ * @param aux: unused
+ */
+static void cat(void *aux __attribute__ ((unused))) {
+    std_stream *in = GET_STDIN(PROC_CUR());
+    std_stream *out = GET_STDOUT(PROC_CUR());
+    char buf[PIPE_IO_SIZE];
+    int n;
+
+    while ((n = stream_read_wait(in, buf, PIPE_IO_SIZE, 0)) > 0)
+        stream_write_wait(out, buf, n);
+}
+
 /* novelty command */
 static void grub(void *aux __attribute__ ((unused))) {
-    kprintf("GRUB is ok\n\n\n\ni guess...\n");
+    printf("GRUB is ok\n\n\n\ni guess...\n");
 }
 
 /* novelty command */
 static void moon(void *aux __attribute__ ((unused))) {
-    kprintf("did you mean: ");
-
-    get_default_dis_driver()->dis_setcol(0xff0000, 0x0);
-    
-    kprintf("\"GAMER GOD MOONMOON\"?\n");
-    
-    get_default_dis_driver()->dis_setcol(0xffffff, 0x0);
-
+    printf("did you mean: \x1b[91m\"GAMER GOD MOONMOON\"?\x1b[0m\n");
 }
@@ -24,7 +24,5 @@ global first_switch_entry
 first_switch_entry:
     ;add esp, 8              ;discard switch_threads args
     extern finish_schedule
-    call finish_schedule
-    mov al, 0x20
-    out 0x20, al
+    call finish_schedule    ;EOI was already sent, IRQs only schedule after irq_handler returns
     ret
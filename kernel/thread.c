@@ -15,23 +15,34 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <synch.h>
+#include <idmap.h>
 #include <kerrors.h>
 #include <string.h>
 #include "thread.h"
 #include "proc.h"
 #include "kalloc.h"
 #include "port_io.h"
+#include "cpu.h"
 
 /* defines */
 #define MAX_THREAD_TICKS 8
+#define BOOT_STACK_ORDER 2  // boot.asm reserves 16 KiB for the boot stack
+#define STACK_POOL_MAX 16   // max number of free stacks cached per stack order
+#define STACK_POOL_PREFILL 4    // number of default sized stacks cached at boot
+#define REAPER_BATCH 16     // max number of dying threads the reaper frees before yielding
 
 /* globals */
 static struct list ready_threads;
 static struct list blocked_threads;
 static struct list dying_threads;
+static struct list sleeping_threads;    // blocked threads with a timeout, linked by sleep_node
+static struct list stack_pool[STACK_MAX_ORDER + 1];    // free stacks, linked through their first bytes
+static size_t stack_pool_size[STACK_MAX_ORDER + 1];
 static struct thread *idle_t;
-static bool tids[MAX_TID];
-static uint8_t thread_ticks = 0;
+static struct thread *reaper_t;
+static idmap_t tids;    // maps tids to their threads
+static uint32_t thread_ticks = 0;
+static bool need_resched = false;
 
 /* structs */
 struct thread_func_frame {
@@ -50,11 +61,16 @@ struct stack_frame {
 };
 
 /* prototypes */
-static uint32_t allocate_tid();
 static void thread_execute(thread_function *func, void *aux);
 static void schedule();
 extern void first_switch_entry();
 static void idle(void *aux);
+static void reaper(void *aux);
+static int __thread_unblock(struct thread *thread);
+static uint32_t *thread_get_canary(struct thread *t);
+static void thread_check_stack(struct thread *t);
+static void *thread_stack_alloc(uint8_t order);
+static void thread_stack_free(void *s, uint8_t order);
 // static size_t num_threads();
 // static void print_ready();
 
@@ -73,12 +89,34 @@ void init_threads(struct process *init) {
     list_init(&ready_threads);
     list_init(&blocked_threads);
     list_init(&dying_threads);
+    list_init(&sleeping_threads);
+    idmap_init(&tids, MAX_TID);
+
+    for (int i = 0; i <= STACK_MAX_ORDER; i++) {
+        list_init(&stack_pool[i]);
+        stack_pool_size[i] = 0;
+    }
+
+    for (int i = 0; i < STACK_POOL_PREFILL; i++) {
+        void *s = palloc_aligned(STACK_SIZE(STACK_DEFAULT_ORDER) / PG_SIZE, STACK_ALIGN / PG_SIZE);
+        if (s != NULL)
+            thread_stack_free(s, STACK_DEFAULT_ORDER);
+    }
 
     thread_create(0, "idle", init, 0, idle, NULL);
     idle_t = init->threads[0];
+    thread_create(0, "reaper", init, 1, reaper, NULL);
+    reaper_t = init->threads[1];
+    // the boot thread runs as part of init, so PROC_CUR() works before the scheduler starts
+    get_running()->p = init;
     strcpy(THREAD_CUR()->name, "i0");
     THREAD_CUR()->state = THREAD_BLOCKED;
 
+    // the boot stack is aligned like a thread stack, so give it a canary too
+    THREAD_CUR()->stack_order = BOOT_STACK_ORDER;
+    THREAD_CUR()->magic = THREAD_MAGIC;
+    *thread_get_canary(THREAD_CUR()) = STACK_CANARY;
+
     // idle_t->state = THREAD_BLOCKED;
     // list_delete(&ready_threads, &idle_t->node);
     // list_insert(&blocked_threads, &idle_t->node);
@@ -86,7 +124,7 @@ void init_threads(struct process *init) {
 
 /* thread state functions */
 
-/** creates a thread under the given process
+/** creates a thread under the given process with a default sized stack
  * 
  * @param priority: unused
  * @param name: name of thread
@@ -95,35 +133,65 @@ void init_threads(struct process *init) {
  * @param func: function thread should run when scheduled
  * @param aux: func parameters and any extra info
  * 
- * @return tid of the created thread, -1 if creation failed
+ * @return tid of the created thread, -THREAD_CREATE_FAIL if creation failed
  */
 int thread_create(uint8_t priority, char *name, struct process *proc, uint32_t child_num, thread_function func, void *aux) {
-    uint8_t *s = (uint8_t *) palloc_mult(STACK_SIZE / PG_SIZE);
+    return thread_create_stack(priority, name, proc, child_num, func, aux, STACK_DEFAULT_ORDER);
+}
 
-    if (s == NULL)
-        return -1;
+/** creates a thread under the given process with a stack of STACK_SIZE(stack_order) bytes
+ * 
+ * @param priority: unused
+ * @param name: name of thread
+ * @param proc: process to create this thread under
+ * @param child_num: slot of the thread in proc's thread table
+ * @param func: function thread should run when scheduled
+ * @param aux: func parameters and any extra info
+ * @param stack_order: log2 of the number of pages in the stack, at most STACK_MAX_ORDER
+ * 
+ * @return tid of the created thread, -THREAD_CREATE_FAIL if creation failed
+ */
+int thread_create_stack(uint8_t priority, char *name, struct process *proc, uint32_t child_num, thread_function func,
+                        void *aux, uint8_t stack_order) {
+    if (stack_order > STACK_MAX_ORDER)
+        return -THREAD_CREATE_FAIL;
+
+    disable_interrupts();
+    uint8_t *s = (uint8_t *) thread_stack_alloc(stack_order);
+
+    if (s == NULL) {
+        enable_interrupts();
+        return -THREAD_CREATE_FAIL;
+    }
     
     // setup the thread struct at the bottom of the page (lowest addr)
     struct thread_info *ti = (struct thread_info *) s;
 
     // if the max amount of threads on the system is already met don't allow creation
-    if (ti->t.tid == MAX_TID + 1) {
-        kfree((void *) s);
-        return -1;
+    int32_t tid = idmap_alloc(&tids, &ti->t);
+    if (tid < 0) {
+        thread_stack_free(s, stack_order);
+        enable_interrupts();
+        return -THREAD_CREATE_FAIL;
     }
+    enable_interrupts();
 
-    ti->t.tid = allocate_tid();
+    ti->t.tid = tid;
     ti->t.state = THREAD_READY;
     sprintf(ti->t.name, "%s", name);
     ti->t.priority = priority;
     ti->t.pid = proc->pid;
     ti->t.child_num = child_num;
+    ti->t.stack_order = stack_order;
     
     // add a pointer to the parent process after thread struct
     ti->p = proc;
     proc->threads[child_num] = &ti->t;
 
-    s += STACK_SIZE;
+    // the canary sits between the thread struct and the stack
+    *thread_get_canary(&ti->t) = STACK_CANARY;
+
+    s += STACK_SIZE(stack_order);
 
     // setup arguments thread_execute
     s -= sizeof(struct thread_func_frame);
@@ -165,42 +233,61 @@ int thread_create(uint8_t priority, char *name, struct process *proc, uint32_t c
  */
 void thread_block() {
     disable_interrupts();
-    struct list_node *node = list_delete(&ready_threads, &THREAD_CUR()->node);
 
-    // running threads aren't in the ready list, so we
-    // need to account for that case
-    if (node == NULL || THREAD_CUR()->state != THREAD_RUNNING) {
+    // running threads usually aren't in the ready list, but the
+    // running thread stays in it when it was the only ready thread
+    list_delete(&ready_threads, &THREAD_CUR()->node);
+
+    if (THREAD_CUR()->state != THREAD_RUNNING) {
         enable_interrupts();
         return;
     }
     
     THREAD_CUR()->state = THREAD_BLOCKED;
-    list_insert(&blocked_threads, node);
+    list_insert(&blocked_threads, &THREAD_CUR()->node);
 
     schedule();
 }
 
-/** unblocks a thread and sets it to ready to run 
+/** blocks the running thread until it is unblocked or ticks timer ticks pass
+ * callers that check a wake condition before blocking should disable interrupts
+ * around the check, so a wakeup can't slip in between the check and the block
  * 
- * @param thread: thread to unblock
+ * @param ticks: number of timer ticks to block for at most, 0 blocks until unblocked
+ * 
+ * @return true if the thread was woken by the timeout, false otherwise
  */
-void thread_unblock(struct thread *thread) {
+bool thread_block_timeout(uint32_t ticks) {
+    struct thread *t = THREAD_CUR();
+
     disable_interrupts();
-    if (thread->state != THREAD_BLOCKED) {
-        enable_interrupts();
-        return;
+    t->timed_out = false;
+
+    if (ticks != 0) {
+        t->wake_tick = thread_ticks + ticks;
+        list_insert(&sleeping_threads, &t->sleep_node);
     }
 
-    struct list_node *node = list_delete(&blocked_threads, &thread->node);
+    thread_block();
 
-    if (node == NULL) {
-        enable_interrupts();
-        return;
-    }
-    
-    thread->state = THREAD_READY;
-    list_insert(&ready_threads, node);
+    // the timer removes the thread from the sleeping list when it times out
+    disable_interrupts();
+    if (ticks != 0 && !t->timed_out)
+        list_delete(&sleeping_threads, &t->sleep_node);
     enable_interrupts();
+
+    return t->timed_out;
+}
+
+/** unblocks a thread and sets it to ready to run
+ * safe to call from interrupt handlers and with interrupts disabled
+ * 
+ * @param thread: thread to unblock
+ */
+void thread_unblock(struct thread *thread) {
+    uint32_t flags = cpu_irq_save();
+    __thread_unblock(thread);
+    cpu_irq_restore(flags);
 }
 
 /** function called at the end of the current thread's lifecycle 
@@ -282,12 +369,14 @@ static int thread_cleanup(struct thread *t) {
     t_proc->threads[t->child_num] = NULL;
     t_proc->num_live_threads--;
 
+    // drops the reference the process' threads held
     if (t_proc->num_live_threads == 0) {
         proc_cleanup(t_proc);
-        pfree(t_proc);
+        proc_release(t_proc);
     }
 
-    pfree_mult((void *) t, STACK_SIZE / PG_SIZE);
+    idmap_free(&tids, t->tid);
+    thread_stack_free((void *) t, t->stack_order);
     return 0;
 }
 
@@ -332,13 +421,25 @@ int thread_kill(struct thread *thread) {
     }
 
     thread_notify(thread, true, -1);
-    // list_insert(&dying_threads, node);
-    thread_cleanup(thread);
+    list_insert(&dying_threads, &thread->node);
+    __thread_unblock(reaper_t);
     enable_interrupts();
 
     return 0;
 }
 
+/* thread "getter" functions */
+
+/** gets the thread with id tid
+ * 
+ * @param tid: id of the thread to get
+ * 
+ * @return thread with id tid, NULL if no such thread exists
+ */
+struct thread *thread_get(uint32_t tid) {
+    return (struct thread *) idmap_get(&tids, tid);
+}
+
 /* scheduling functions */
 
 /** yields the remainder of this thread's time slice */
@@ -346,7 +447,8 @@ void thread_yield() {
     schedule();
 }
 
-/** interrupt handler for the timer interrupt, also starts scheduling periodically
+/** interrupt handler for the timer interrupt, also requests scheduling periodically
+ * this runs on the irq stack, so the actual switch is done in thread_preempt()
  * 
  * @param r: unused
  */
@@ -354,7 +456,35 @@ void timer_interrupt_handler(struct register_frame *r __attribute__ ((unused)))
     thread_ticks++;
     THREAD_CUR()->ticks++;
 
+    list_node_t *node = sleeping_threads.head.next;
+    while (node != &sleeping_threads.tail) {
+        list_node_t *next = node->next;
+        struct thread *t = LIST_ENTRY(node, struct thread, sleep_node);
+
+        // threads that were already woken remove themselves once they run
+        if (t->state == THREAD_BLOCKED && (int32_t) (thread_ticks - t->wake_tick) >= 0) {
+            node->prev->next = next;
+            next->prev = node->prev;
+            node->prev = node->next = NULL;
+
+            t->timed_out = true;
+            __thread_unblock(t);
+        }
+
+        node = next;
+    }
+
     if (thread_ticks % MAX_THREAD_TICKS == 0) {
+        need_resched = true;
+    }
+}
+
+/** schedules if an IRQ requested it
+ * called by irq_common_stub once it is back on the interrupted thread's stack
+ */
+void thread_preempt() {
+    if (need_resched) {
+        need_resched = false;
         schedule();
     }
 }
@@ -368,13 +498,6 @@ void finish_schedule() {
     cur->state = THREAD_RUNNING;
     proc_set_active_thread(PROC_CUR(), cur->child_num);
 
-    if (list_isEmpty(&dying_threads) == false) {
-        disable_interrupts();
-        struct thread *dying = LIST_ENTRY(list_pop(&dying_threads), struct thread, node);
-        if (dying != NULL)
-            thread_cleanup(dying);
-    }
-
     enable_interrupts();
 }
 
@@ -404,7 +527,7 @@ static void schedule() {
     // otherwise we just pull one of the top
     if (next == NULL) {
         next_thread = idle_t;
-        thread_unblock(idle_t);
+        __thread_unblock(idle_t);
     } else {
         next_thread = LIST_ENTRY(next, struct thread, node);
     }
@@ -412,8 +535,11 @@ static void schedule() {
     if (current->state == THREAD_RUNNING)
         current->state = THREAD_READY;
 
-    if (current->state == THREAD_DYING)
+    // the reaper frees dying threads, so the switch path only has to queue them
+    if (current->state == THREAD_DYING) {
         list_insert(&dying_threads, &current->node);
+        __thread_unblock(reaper_t);
+    }
     
     if (current->state == THREAD_READY)
         list_insert_end(&ready_threads.tail, &current->node);
@@ -428,6 +554,8 @@ static void schedule() {
         return;
     }
 
+    thread_check_stack(current);
+    thread_check_stack(next_thread);
     switch_threads(current, next_thread);
 
     finish_schedule();
@@ -443,19 +571,112 @@ static void idle(void *aux __attribute__ ((unused))) {
     };
 }
 
-/** allocates a thread id for when a thread is being created
+/** function that the reaper thread runs, frees dying threads and their processes
+ * dying threads are freed REAPER_BATCH at a time, and the reaper blocks
+ * whenever there are no dying threads left
  * 
- * @return tid of new thread
+ * @param aux: unused
  */
-static uint32_t allocate_tid() {
-    int i;
-    for (i = 0; i < MAX_TID; i++)
-        if (tids[i] == false) {
-            tids[i] = true;
-            return i;
+static void reaper(void *aux __attribute__ ((unused))) {
+    while (1) {
+        disable_interrupts();
+
+        list_node_t *node;
+        int i;
+        for (i = 0; i < REAPER_BATCH && (node = list_pop(&dying_threads)) != NULL; i++)
+            thread_cleanup(LIST_ENTRY(node, struct thread, node));
+
+        // interrupts stay disabled until we block so a new dying thread can't be missed
+        if (list_isEmpty(&dying_threads)) {
+            thread_block();
+        } else {
+            enable_interrupts();
+            thread_yield();
         }
+    }
+}
+
+/** unblocks a thread and sets it to ready to run
+ * interrupts must be disabled when calling this function
+ * 
+ * @param thread: thread to unblock
+ * 
+ * @return 0 if thread was unblocked, -1 otherwise
+ */
+static int __thread_unblock(struct thread *thread) {
+    if (thread == NULL || thread->state != THREAD_BLOCKED)
+        return -1;
+
+    struct list_node *node = list_delete(&blocked_threads, &thread->node);
+
+    if (node == NULL)
+        return -1;
     
-    return MAX_TID + 1;
+    thread->state = THREAD_READY;
+    list_insert(&ready_threads, node);
+    return 0;
+}
+
+/** gets the address of the canary word of thread t
+ * the canary is the first word past the thread_info struct, so it is the
+ * last word of the stack that can be used before the thread struct is overwritten
+ * 
+ * @param t: thread to get the canary of
+ * 
+ * @return pointer to the canary of t
+ */
+static uint32_t *thread_get_canary(struct thread *t) {
+    return (uint32_t *) ((thread_info_t *) t + 1);
+}
+
+/** halts the machine if thread t has overflowed its stack
+ * an overflow is detected by a clobbered canary or thread magic
+ * 
+ * @param t: thread to check
+ */
+static void thread_check_stack(struct thread *t) {
+    if (*thread_get_canary(t) == STACK_CANARY && t->magic == THREAD_MAGIC)
+        return;
+
+    kprintf("Stack overflow in thread %s (tid %d)\n", t->name, t->tid);
+    asm volatile("cli");
+    asm volatile("hlt");
+}
+
+/** gets a stack of STACK_SIZE(order) bytes aligned to STACK_ALIGN
+ * stacks are taken from the stack pool when possible, and palloc'd otherwise
+ * interrupts must be disabled when calling this function
+ * 
+ * @param order: log2 of the number of pages in the stack
+ * 
+ * @return address of the base of the stack, NULL if allocation fails
+ */
+static void *thread_stack_alloc(uint8_t order) {
+    list_node_t *node = list_pop(&stack_pool[order]);
+    if (node != NULL) {
+        stack_pool_size[order]--;
+        return (void *) node;
+    }
+
+    // the alignment lets get_running() find the thread from any address in the stack
+    return palloc_aligned(STACK_SIZE(order) / PG_SIZE, STACK_ALIGN / PG_SIZE);
+}
+
+/** returns a stack from thread_stack_alloc
+ * the stack is cached in the stack pool unless the pool for order is full
+ * interrupts must be disabled when calling this function
+ * 
+ * @param s: base of the stack to free
+ * @param order: log2 of the number of pages in the stack
+ */
+static void thread_stack_free(void *s, uint8_t order) {
+    if (stack_pool_size[order] >= STACK_POOL_MAX) {
+        pfree_mult(s, STACK_SIZE(order) / PG_SIZE);
+        return;
+    }
+
+    list_insert(&stack_pool[order], (list_node_t *) s);
+    stack_pool_size[order]++;
 }
 
 /* testing functions */
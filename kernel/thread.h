@@ -13,7 +13,11 @@
 #define MAX_PNAME_LENGTH 12
 #define MAX_TNAME_LENGTH 24
 #define MAX_TID 512
-#define STACK_SIZE PG_SIZE
+#define STACK_MAX_ORDER 3   // largest stack is PG_SIZE << STACK_MAX_ORDER bytes
+#define STACK_DEFAULT_ORDER 0
+#define STACK_ALIGN (PG_SIZE << STACK_MAX_ORDER)  // every thread stack starts on this boundary
+#define STACK_SIZE(order) (PG_SIZE << (order))
+#define STACK_CANARY 0x57ACC0DE
 #define THREAD_CUR() ((struct thread *) &get_running()->t)
 #define PROC_CUR() ((struct process *) get_running()->p)
 #define THREAD_MAGIC 0x33
@@ -36,9 +40,14 @@ struct thread {
 
     list_t waiters;   // list of threads waiting on this one
     int wait_code; // code of thread that this thread is waiting on
-    list_node_t wait_node; // node for waiting on threads
+    list_node_t wait_node; // node for waiting on threads or wait queues
+
+    list_node_t sleep_node; // node for the list of threads blocked with a timeout
+    uint32_t wake_tick; // tick at which a thread blocked with a timeout is woken
+    bool timed_out; // whether the last block with a timeout ran out
 
     list_node_t node; // list node for ready and non-ready lists
+    uint8_t stack_order; // the stack of the thread is STACK_SIZE(stack_order) bytes
     uint32_t magic;
 };
 
@@ -60,7 +69,10 @@ void init_threads(struct process *init_p);
 
 /* thread state functions */
 int thread_create(uint8_t priority, char *name, struct process *proc, uint32_t child_num, thread_function func, void *aux);
+int thread_create_stack(uint8_t priority, char *name, struct process *proc, uint32_t child_num, thread_function func,
+                        void *aux, uint8_t stack_order);
 void thread_block();
+bool thread_block_timeout(uint32_t ticks);
 void thread_unblock(struct thread *thread);
 void thread_exit(int *ret);
 int thread_kill(struct thread *thread);
@@ -68,20 +80,27 @@ int thread_wait(struct thread *thread);
 int thread_notify(struct thread *thread, bool all, int ret);
 
 /* thread "getter" functions */
+struct thread *thread_get(uint32_t tid);
 
 /* gets the thread_info struct of the thread use either 
    the THREAD_CUR() or PROC_CUR() macros instead of this function */
 static inline struct thread_info *get_running() {
     uint32_t esp;
     asm volatile ("mov %%esp, %0" : "=g" (esp));
-    // chop off last 12 bits to round to bottom of page
-    esp = esp & (~(STACK_SIZE - 1));
+    // stacks are aligned to STACK_ALIGN and no bigger than it, so this rounds to the stack base
+    esp = esp & (~(STACK_ALIGN - 1));
+
+    // IRQ handlers run on the irq stack, which stores the interrupted thread at its base
+    if (esp == (uint32_t) irq_stack)
+        return *((struct thread_info **) esp);
+
     return (struct thread_info *) esp;
 }
 
 /* scheduling functions */
 void thread_yield();
 void timer_interrupt_handler(struct register_frame *r);
+void thread_preempt();
 void finish_schedule();
 
 #endif
\ No newline at end of file
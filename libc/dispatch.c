@@ -0,0 +1,46 @@
+/* Picks the best variant of each dispatched libc routine for the running CPU. */
+
+/* includes */
+#include <dispatch.h>
+#include "../kernel/cpu.h"
+
+/* defines */
+
+/* globals */
+struct dispatch_table dispatch = {
+    .memcpy = memcpy_base,
+    .memset = memset_base,
+    .memset32 = memset32_base,
+    .strlen = strlen_base
+};
+
+/* functions */
+
+/** patches the dispatch table with the best variants the CPU supports
+ * must be called after init_cpu(), routines called before this use the baseline variants
+ */
+void init_dispatch() {
+    // rep movsb with ERMS is as fast as SIMD copies and doesn't need interrupts disabled
+    if (cpu_has(CPU_FEAT_ERMS))
+        dispatch.memcpy = memcpy_erms;
+    else if (cpu_has(CPU_FEAT_AVX))
+        dispatch.memcpy = memcpy_avx;
+    else if (cpu_has(CPU_FEAT_SSE2))
+        dispatch.memcpy = memcpy_sse2;
+
+    // the SIMD fills only differ for large fills, where they bypass the cache
+    if (cpu_has(CPU_FEAT_AVX))
+        dispatch.memset = memset_avx;
+    else if (cpu_has(CPU_FEAT_SSE2))
+        dispatch.memset = memset_sse2;
+    else if (cpu_has(CPU_FEAT_ERMS))
+        dispatch.memset = memset_erms;
+
+    if (cpu_has(CPU_FEAT_AVX))
+        dispatch.memset32 = memset32_avx;
+    else if (cpu_has(CPU_FEAT_SSE2))
+        dispatch.memset32 = memset32_sse2;
+
+    if (cpu_has(CPU_FEAT_SSE2))
+        dispatch.strlen = strlen_sse2;
+}
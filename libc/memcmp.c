@@ -2,30 +2,41 @@
 
 /* includes */
 #include <stddef.h>
+#include <stdint.h>
 #include <mem.h>
 
 /* defines */
+typedef uint32_t __attribute__ ((may_alias)) word_t;
 
 /* globals */
 
 /* functions */
 
 /** compares n bytes from p2 to p1
+ * equal prefixes are skipped 4 bytes at a time
  * 
  * @param p1: destination pointer
  * @param p2: source pointer
- * @param n: number of bytes to copy
+ * @param n: number of bytes to compare
  * 
  * @return difference between first differing byte (p1 - p2), or 0 if bytes don't differ
  */
 int memcmp(const void *p1, const void *p2, size_t n) {
-    const char *a = (const char *) p1;
-    const char *b = (const char *) p2;
+    const unsigned char *a = (const unsigned char *) p1;
+    const unsigned char *b = (const unsigned char *) p2;
 
-    size_t i;
-    for (i = 0; i < n; i++)
-        if (*a - *b != 0)
+    // x86 handles misaligned loads, so only a is aligned
+    for (; n > 0 && ((uintptr_t) a & 3); n--, a++, b++)
+        if (*a != *b)
+            return *a - *b;
+
+    for (; n >= 4; n -= 4, a += 4, b += 4)
+        if (*(const word_t *) a != *(const word_t *) b)
+            break;
+
+    for (; n > 0; n--, a++, b++)
+        if (*a != *b)
             return *a - *b;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,16 +1,22 @@
-/* Implementation of memcpy. */
+/* Implementation of memcpy and its CPU specific variants. */
 
 /* includes */
 #include <stddef.h>
+#include <stdint.h>
 #include <mem.h>
+#include <dispatch.h>
+#include "../kernel/cpu.h"
 
 /* defines */
+#define MEMCPY_SMALL 16 // copies smaller than this aren't worth the setup of rep movs
+#define MEMCPY_SIMD_MIN 256 // copies smaller than this aren't worth disabling interrupts for
+#define MEMCPY_SIMD_CHUNK 4096  // bytes copied per SIMD chunk with interrupts disabled
 
 /* globals */
 
 /* functions */
 
-/** copies n bytes at src to dest
+/** copies n bytes at src to dest using the best variant for the CPU
  * 
  * @param dest: destination pointer
  * @param src: source pointer
@@ -19,12 +25,146 @@
  * @return pointer to the start of copied memory
  */
 void *memcpy(void *dest, const void *src, size_t n) {
-    char *dest_char = (char *) dest;
-    char *src_char = (char *) src;
+    return dispatch.memcpy(dest, src, n);
+}
+
+/** copies n bytes at src to dest
+ * the destination is aligned to 4 bytes first, then the bulk is copied with rep movsd
+ * 
+ * @param dest: destination pointer
+ * @param src: source pointer
+ * @param n: number of bytes to copy
+ *
+ * @return pointer to the start of copied memory
+ */
+void *memcpy_base(void *dest, const void *src, size_t n) {
+    uint8_t *d = (uint8_t *) dest;
+    const uint8_t *s = (const uint8_t *) src;
+
+    if (n < MEMCPY_SMALL) {
+        while (n--)
+            *d++ = *s++;
+        return dest;
+    }
+
+    // misaligned stores cost more than misaligned loads, so align the destination
+    size_t head = (-(uintptr_t) d) & 3;
+    size_t words = (n - head) >> 2;
+    size_t tail = (n - head) & 3;
+
+    asm volatile("rep movsb" : "+D" (d), "+S" (s), "+c" (head) : : "memory");
+    asm volatile("rep movsl" : "+D" (d), "+S" (s), "+c" (words) : : "memory");
+    asm volatile("rep movsb" : "+D" (d), "+S" (s), "+c" (tail) : : "memory");
+
+    return dest;
+}
+
+/** copies n bytes at src to dest with a single rep movsb
+ * only used on CPUs with enhanced rep movsb, which handle alignment themselves
+ * 
+ * @param dest: destination pointer
+ * @param src: source pointer
+ * @param n: number of bytes to copy
+ *
+ * @return pointer to the start of copied memory
+ */
+void *memcpy_erms(void *dest, const void *src, size_t n) {
+    void *d = dest;
+    asm volatile("rep movsb" : "+D" (d), "+S" (src), "+c" (n) : : "memory");
+    return dest;
+}
+
+/** copies n bytes at src to dest 64 bytes at a time with SSE2 loads and aligned stores
+ * each chunk is copied with interrupts disabled, since xmm registers aren't saved
+ * on context switches
+ * 
+ * @param dest: destination pointer
+ * @param src: source pointer
+ * @param n: number of bytes to copy
+ *
+ * @return pointer to the start of copied memory
+ */
+__attribute__ ((target ("sse2")))
+void *memcpy_sse2(void *dest, const void *src, size_t n) {
+    uint8_t *d = (uint8_t *) dest;
+    const uint8_t *s = (const uint8_t *) src;
+
+    if (n < MEMCPY_SIMD_MIN)
+        return memcpy_base(dest, src, n);
+    
+    size_t head = (-(uintptr_t) d) & 15;
+    n -= head;
+    asm volatile("rep movsb" : "+D" (d), "+S" (s), "+c" (head) : : "memory");
+
+    while (n >= 64) {
+        size_t chunk = n < MEMCPY_SIMD_CHUNK ? n & ~63 : MEMCPY_SIMD_CHUNK;
+        size_t blocks = chunk / 64;
+        n -= chunk;
+
+        uint32_t flags = cpu_irq_save();
+        asm volatile("1:\n\t"
+                     "movdqu (%1), %%xmm0\n\t"
+                     "movdqu 16(%1), %%xmm1\n\t"
+                     "movdqu 32(%1), %%xmm2\n\t"
+                     "movdqu 48(%1), %%xmm3\n\t"
+                     "movdqa %%xmm0, (%0)\n\t"
+                     "movdqa %%xmm1, 16(%0)\n\t"
+                     "movdqa %%xmm2, 32(%0)\n\t"
+                     "movdqa %%xmm3, 48(%0)\n\t"
+                     "addl $64, %1\n\t"
+                     "addl $64, %0\n\t"
+                     "decl %2\n\t"
+                     "jnz 1b"
+                     : "+r" (d), "+r" (s), "+r" (blocks) : : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm3");
+        cpu_irq_restore(flags);
+    }
+
+    memcpy_base(d, s, n);
+    return dest;
+}
+
+/** copies n bytes at src to dest 64 bytes at a time with AVX loads and aligned stores
+ * each chunk is copied with interrupts disabled, since ymm registers aren't saved
+ * on context switches
+ * 
+ * @param dest: destination pointer
+ * @param src: source pointer
+ * @param n: number of bytes to copy
+ *
+ * @return pointer to the start of copied memory
+ */
+__attribute__ ((target ("avx")))
+void *memcpy_avx(void *dest, const void *src, size_t n) {
+    uint8_t *d = (uint8_t *) dest;
+    const uint8_t *s = (const uint8_t *) src;
+
+    if (n < MEMCPY_SIMD_MIN)
+        return memcpy_base(dest, src, n);
+    
+    size_t head = (-(uintptr_t) d) & 31;
+    n -= head;
+    asm volatile("rep movsb" : "+D" (d), "+S" (s), "+c" (head) : : "memory");
+
+    while (n >= 64) {
+        size_t chunk = n < MEMCPY_SIMD_CHUNK ? n & ~63 : MEMCPY_SIMD_CHUNK;
+        size_t blocks = chunk / 64;
+        n -= chunk;
 
-    size_t i;
-    for (i = 0; i < n; i++)
-        dest_char[i] = src_char[i];
+        uint32_t flags = cpu_irq_save();
+        asm volatile("1:\n\t"
+                     "vmovdqu (%1), %%ymm0\n\t"
+                     "vmovdqu 32(%1), %%ymm1\n\t"
+                     "vmovdqa %%ymm0, (%0)\n\t"
+                     "vmovdqa %%ymm1, 32(%0)\n\t"
+                     "addl $64, %1\n\t"
+                     "addl $64, %0\n\t"
+                     "decl %2\n\t"
+                     "jnz 1b\n\t"
+                     "vzeroupper"
+                     : "+r" (d), "+r" (s), "+r" (blocks) : : "memory", "cc", "xmm0", "xmm1");
+        cpu_irq_restore(flags);
+    }
 
+    memcpy_base(d, s, n);
     return dest;
-}
\ No newline at end of file
+}
@@ -2,6 +2,7 @@
 
 /* includes */
 #include <stddef.h>
+#include <stdint.h>
 #include <mem.h>
 
 /* defines */
@@ -11,6 +12,7 @@
 /* functions */
 
 /** moves n bytes from src to dest
+ * overlapping regions where dest is after src are copied backwards with rep movsd
  * 
  * @param dest: destination pointer
  * @param src: source pointer
@@ -19,17 +21,36 @@
  * @return pointer to start of where memory was moved to
  */
 void *memmove(void *dest, const void *src, size_t n) {
+    uint8_t *d = (uint8_t *) dest;
+    const uint8_t *s = (const uint8_t *) src;
 
-    if (dest < src)
+    // a forward copy is safe unless dest starts inside src
+    if (d <= s || d >= s + n)
         return memcpy(dest, src, n);
-    else {
-        char *d = (char *) dest;
-        const char *s = (char *) src;
-
-        size_t i;
-        for (i = n; i > 0; i--)
-            d[i - 1] = s[i - 1];
+    
+    d += n;
+    s += n;
+
+    // align the end of the destination
+    while (n > 0 && ((uintptr_t) d & 3)) {
+        *--d = *--s;
+        n--;
     }
 
+    size_t words = n >> 2;
+    uint8_t *dw = d - 4;
+    const uint8_t *sw = s - 4;
+    asm volatile("std\n\t"
+                 "rep movsl\n\t"
+                 "cld"
+                 : "+D" (dw), "+S" (sw), "+c" (words) : : "memory");
+    
+    d -= n & ~3;
+    s -= n & ~3;
+    n &= 3;
+
+    while (n--)
+        *--d = *--s;
+
     return dest;
-}
\ No newline at end of file
+}
@@ -1,16 +1,28 @@
-/* Implementation of memset. */
+/* Implementation of memset, memset32 and their CPU specific variants. */
 
 /* includes */
 #include <stddef.h>
+#include <stdint.h>
 #include <mem.h>
+#include <dispatch.h>
+#include "../kernel/cpu.h"
 
 /* defines */
+#define MEMSET_SMALL 16 // fills smaller than this aren't worth the setup of rep stos
+#define MEMSET_NT_MIN 4096  // fills at least this big bypass the cache with SIMD stores
+#define MEMSET_NT_CHUNK 4096    // bytes filled per SIMD chunk with interrupts disabled
+#define BYTE_ONES 0x01010101u   // a byte times this is the byte repeated in every byte of a word
 
 /* globals */
 
+/* prototypes */
+static void memset_fill(uint8_t *d, uint32_t fill, size_t n, size_t align, void (*fill_nt)(uint8_t *, uint32_t, size_t));
+static void memset_nt_sse2(uint8_t *d, uint32_t fill, size_t n);
+static void memset_nt_avx(uint8_t *d, uint32_t fill, size_t n);
+
 /* functions */
 
-/** sets n bytes at dest to c
+/** sets n bytes at dest to c using the best variant for the CPU
  * 
  * @param dest: destination pointer
  * @param c: value to set
@@ -19,13 +31,234 @@
  * @return pointer to memory that was set
  */
 void *memset(void *dest, int c, size_t n) {
-    unsigned char *d = (unsigned char *) dest;
-    size_t i = 0;
+    return dispatch.memset(dest, c, n);
+}
 
-    while (i < n) {
-        *d = c;
-        i++;
+/** sets n 32 bit words at dest to val using the best variant for the CPU
+ * NOTE: not a stdlib function
+ * 
+ * @param dest: 4 byte aligned destination pointer
+ * @param val: value to set
+ * @param n: number of words to set
+ * 
+ * @return pointer to memory that was set
+ */
+void *memset32(void *dest, uint32_t val, size_t n) {
+    return dispatch.memset32(dest, val, n);
+}
+
+/** sets n bytes at dest to c
+ * the destination is aligned to 4 bytes first, then the bulk is set with rep stosd
+ * 
+ * @param dest: destination pointer
+ * @param c: value to set
+ * @param n: number of bytes to set
+ * 
+ * @return pointer to memory that was set
+ */
+void *memset_base(void *dest, int c, size_t n) {
+    uint8_t *d = (uint8_t *) dest;
+
+    if (n < MEMSET_SMALL) {
+        while (n--)
+            *d++ = (uint8_t) c;
+        return dest;
     }
 
+    memset_fill(d, (uint32_t) (uint8_t) c * BYTE_ONES, n, 4, NULL);
     return dest;
-}
\ No newline at end of file
+}
+
+/** sets n bytes at dest to c with a single rep stosb
+ * only used on CPUs with enhanced rep stosb, which handle alignment themselves
+ * 
+ * @param dest: destination pointer
+ * @param c: value to set
+ * @param n: number of bytes to set
+ * 
+ * @return pointer to memory that was set
+ */
+void *memset_erms(void *dest, int c, size_t n) {
+    void *d = dest;
+    asm volatile("rep stosb" : "+D" (d), "+c" (n) : "a" (c) : "memory");
+    return dest;
+}
+
+/** sets n bytes at dest to c, large fills use non-temporal SSE2 stores
+ * 
+ * @param dest: destination pointer
+ * @param c: value to set
+ * @param n: number of bytes to set
+ * 
+ * @return pointer to memory that was set
+ */
+void *memset_sse2(void *dest, int c, size_t n) {
+    if (n < MEMSET_NT_MIN)
+        return memset_base(dest, c, n);
+
+    memset_fill((uint8_t *) dest, (uint32_t) (uint8_t) c * BYTE_ONES, n, 16, memset_nt_sse2);
+    return dest;
+}
+
+/** sets n bytes at dest to c, large fills use non-temporal AVX stores
+ * 
+ * @param dest: destination pointer
+ * @param c: value to set
+ * @param n: number of bytes to set
+ * 
+ * @return pointer to memory that was set
+ */
+void *memset_avx(void *dest, int c, size_t n) {
+    if (n < MEMSET_NT_MIN)
+        return memset_base(dest, c, n);
+
+    memset_fill((uint8_t *) dest, (uint32_t) (uint8_t) c * BYTE_ONES, n, 32, memset_nt_avx);
+    return dest;
+}
+
+/** sets n 32 bit words at dest to val with rep stosd
+ * 
+ * @param dest: 4 byte aligned destination pointer
+ * @param val: value to set
+ * @param n: number of words to set
+ * 
+ * @return pointer to memory that was set
+ */
+void *memset32_base(void *dest, uint32_t val, size_t n) {
+    void *d = dest;
+    asm volatile("rep stosl" : "+D" (d), "+c" (n) : "a" (val) : "memory");
+    return dest;
+}
+
+/** sets n 32 bit words at dest to val, large fills use non-temporal SSE2 stores
+ * 
+ * @param dest: 4 byte aligned destination pointer
+ * @param val: value to set
+ * @param n: number of words to set
+ * 
+ * @return pointer to memory that was set
+ */
+void *memset32_sse2(void *dest, uint32_t val, size_t n) {
+    if (n * 4 < MEMSET_NT_MIN)
+        return memset32_base(dest, val, n);
+    
+    memset_fill((uint8_t *) dest, val, n * 4, 16, memset_nt_sse2);
+    return dest;
+}
+
+/** sets n 32 bit words at dest to val, large fills use non-temporal AVX stores
+ * 
+ * @param dest: 4 byte aligned destination pointer
+ * @param val: value to set
+ * @param n: number of words to set
+ * 
+ * @return pointer to memory that was set
+ */
+void *memset32_avx(void *dest, uint32_t val, size_t n) {
+    if (n * 4 < MEMSET_NT_MIN)
+        return memset32_base(dest, val, n);
+    
+    memset_fill((uint8_t *) dest, val, n * 4, 32, memset_nt_avx);
+    return dest;
+}
+
+/* static functions */
+
+/** fills n bytes at d with the 4 byte pattern fill
+ * the head is filled until d is aligned to align, then the bulk is filled with fill_nt
+ * (if given) and the rest with rep stosd
+ * 
+ * @param d: destination, must be 4 byte aligned if the bytes of fill differ
+ * @param fill: 4 byte pattern to fill with
+ * @param n: number of bytes to fill
+ * @param align: alignment fill_nt requires, a power of two and at least 4
+ * @param fill_nt: function to fill an aligned multiple of 64 bytes, or NULL
+ */
+static void memset_fill(uint8_t *d, uint32_t fill, size_t n, size_t align, void (*fill_nt)(uint8_t *, uint32_t, size_t)) {
+    size_t head = (-(uintptr_t) d) & 3;
+    if (head > n)
+        head = n;
+    n -= head;
+    asm volatile("rep stosb" : "+D" (d), "+c" (head) : "a" (fill) : "memory");
+
+    if (fill_nt) {
+        head = ((-(uintptr_t) d) & (align - 1)) >> 2;
+        if (head * 4 > n)
+            head = n >> 2;
+        n -= head * 4;
+        asm volatile("rep stosl" : "+D" (d), "+c" (head) : "a" (fill) : "memory");
+
+        size_t bulk = n & ~63;
+        if (bulk > 0)
+            fill_nt(d, fill, bulk);
+        d += bulk;
+        n -= bulk;
+    }
+
+    size_t words = n >> 2;
+    size_t tail = n & 3;
+    asm volatile("rep stosl" : "+D" (d), "+c" (words) : "a" (fill) : "memory");
+    asm volatile("rep stosb" : "+D" (d), "+c" (tail) : "a" (fill) : "memory");
+}
+
+/** fills n bytes at d with fill using non-temporal SSE2 stores
+ * the fill is done in chunks with interrupts disabled, since xmm registers
+ * aren't saved on context switches
+ * 
+ * @param d: 16 byte aligned destination
+ * @param fill: 4 byte pattern to fill with
+ * @param n: number of bytes to fill, a multiple of 64
+ */
+__attribute__ ((target ("sse2")))
+static void memset_nt_sse2(uint8_t *d, uint32_t fill, size_t n) {
+    while (n > 0) {
+        size_t chunk = n < MEMSET_NT_CHUNK ? n : MEMSET_NT_CHUNK;
+        size_t blocks = chunk / 64;
+        n -= chunk;
+
+        uint32_t flags = cpu_irq_save();
+        asm volatile("movd %2, %%xmm0\n\t"
+                     "pshufd $0, %%xmm0, %%xmm0\n"
+                     "1:\n\t"
+                     "movntdq %%xmm0, (%0)\n\t"
+                     "movntdq %%xmm0, 16(%0)\n\t"
+                     "movntdq %%xmm0, 32(%0)\n\t"
+                     "movntdq %%xmm0, 48(%0)\n\t"
+                     "addl $64, %0\n\t"
+                     "decl %1\n\t"
+                     "jnz 1b\n\t"
+                     "sfence"
+                     : "+r" (d), "+r" (blocks) : "r" (fill) : "memory", "cc", "xmm0");
+        cpu_irq_restore(flags);
+    }
+}
+
+/** fills n bytes at d with fill using non-temporal AVX stores
+ * the fill is done in chunks with interrupts disabled, since ymm registers
+ * aren't saved on context switches
+ * 
+ * @param d: 32 byte aligned destination
+ * @param fill: 4 byte pattern to fill with
+ * @param n: number of bytes to fill, a multiple of 64
+ */
+__attribute__ ((target ("avx")))
+static void memset_nt_avx(uint8_t *d, uint32_t fill, size_t n) {
+    while (n > 0) {
+        size_t chunk = n < MEMSET_NT_CHUNK ? n : MEMSET_NT_CHUNK;
+        size_t blocks = chunk / 64;
+        n -= chunk;
+
+        uint32_t flags = cpu_irq_save();
+        asm volatile("vbroadcastss %2, %%ymm0\n"
+                     "1:\n\t"
+                     "vmovntdq %%ymm0, (%0)\n\t"
+                     "vmovntdq %%ymm0, 32(%0)\n\t"
+                     "addl $64, %0\n\t"
+                     "decl %1\n\t"
+                     "jnz 1b\n\t"
+                     "sfence\n\t"
+                     "vzeroupper"
+                     : "+r" (d), "+r" (blocks) : "m" (fill) : "memory", "cc", "xmm0");
+        cpu_irq_restore(flags);
+    }
+}
@@ -8,107 +8,108 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <mem.h>
 #include <stream.h>
 #include "../drivers/display.h"
+#include "../drivers/terminal.h"
 #include "../kernel/proc.h"
 #include "../kernel/thread.h"
 
 /* defines */
+#define PRINTF_BUF_SIZE 256  // size of the stack buffer kprintf/printf format into
+
+#define FMT_LEFT (1 << 0)   // '-': left justify within the field width
+#define FMT_ZERO (1 << 1)   // '0': pad numbers with zeros
+#define FMT_PLUS (1 << 2)   // '+': always print a sign
+#define FMT_SPACE (1 << 3)  // ' ': print a space in place of a plus sign
+#define FMT_ALT (1 << 4)    // '#': prefix hex with 0x and octal with 0
+#define FMT_UPPER (1 << 5)  // print hex digits in uppercase
+
+/* structs */
+/* destination of formatted output, characters are collected in buf and
+ * handed to flush whenever it fills up */
+struct printf_out {
+    char *buf;
+    size_t size;    // capacity of buf, including room for a null terminator
+    size_t pos;
+    size_t total;   // number of characters produced, including ones that didn't fit
+    void (*flush)(struct printf_out *out);
+    void *aux;
+};
 
 /* globals */
 
+/* prototypes */
+static int printf_format(struct printf_out *out, const char *format, va_list args);
+static void printf_num(struct printf_out *out, uint64_t val, bool neg, unsigned base, int flags, int width, int prec);
+static void printf_putc(struct printf_out *out, char c);
+static void printf_write(struct printf_out *out, const char *s, size_t n);
+static void printf_pad(struct printf_out *out, char c, int n);
+static void printf_flush_dis(struct printf_out *out);
+static void printf_flush_std(struct printf_out *out);
+
 /* functions */
 
 /** prints a null-terminated string to the screen
+ * the string goes through the terminal of the current process' console, which
+ * interprets escape sequences, or straight to the display if no terminal is attached yet
+ * the boot thread belongs to init, so the kernel's own output goes to console 0
  * 
  * @param string: null-terminated string to print
  */
 void kprint(char *string) {
-    get_default_dis_driver()->dis_puts(string);
+    term_t *t = get_console_terminal(PROC_CUR()->console);
+
+    if (t != NULL)
+        t->term_writes(t, string);
+    else
+        get_default_dis_driver()->dis_puts(string);
 }
 
+/** prints a formatted string to the stdout of the current process
+ * the output is formatted into a buffer and written to the stream all at once
+ * 
+ * @param format: null-terminated string to format and print, see vsnprintf
+ * @param ...: argument for each formatting specifier
+ * 
+ * @return number of characters printed
+ */
 int printf(const char *format, ...) {
+    char buf[PRINTF_BUF_SIZE];
+    struct printf_out out = {buf, PRINTF_BUF_SIZE, 0, 0, printf_flush_std, GET_STDOUT(PROC_CUR())};
+
     va_list args;
     va_start(args, format);
-    std_stream *out = GET_STDOUT(PROC_CUR());
-
-    while (*format != '\0') {
-        if (*format == '%') {
-            format++;
-            if (*format == 'd') {
-                puts_std(out, int_to_string(va_arg(args, int)));
-            } else if (*format == 'x') {
-                puts_std(out, int_to_hexstring(va_arg(args, int)));
-            } else if (*format == 's') {
-                puts_std(out, (va_arg(args, char *)));
-            } else if (*format == 'c') {
-                put_std(out, va_arg(args, int));
-            } else if (*format == 'B') {
-                bool arg = va_arg(args, int);
-                if (arg)
-                    puts_std(out, "true");
-                else
-                    puts_std(out, "false");
-            }
-        } else
-            put_std(out, *format);
-
-        format++;
-    }
-
+    int ret = printf_format(&out, format, args);
     va_end(args);
-    return 0;
+
+    printf_flush_std(&out);
+    return ret;
 }
 
 /** prints a formatted string to the screen
- * Format specifiers:
- *  - %d: decimal number
- *  - %x: hexadecimal number
- *  - %s: null-terminated string
- *  - %B: boolean value as a string
+ * the output is formatted into a buffer and drawn all at once
  * 
- * @param format: null-terminated string to format and print
+ * @param format: null-terminated string to format and print, see vsnprintf
  * @param ...: argument for each formatting specifier
  * 
- * @return 0 on success, -1 otherwise
+ * @return number of characters printed
  */
 int kprintf(const char *format, ...) {
+    char buf[PRINTF_BUF_SIZE];
+    struct printf_out out = {buf, PRINTF_BUF_SIZE, 0, 0, printf_flush_dis, NULL};
+
     va_list args;
     va_start(args, format);
-    display_t *dd = get_default_dis_driver();
-
-    while (*format != '\0') {
-        if (*format == '%') {
-            format++;
-            if (*format == 'd') {
-                char *temp = int_to_string(va_arg(args, int));
-                dd->dis_puts(temp);
-            } else if (*format == 'x') {
-                char *temp = int_to_hexstring(va_arg(args, int));
-                dd->dis_puts(temp);
-            } else if (*format == 's') {
-                dd->dis_puts(va_arg(args, char *));
-            } else if (*format == 'c') {
-                dd->dis_putc(va_arg(args, int));
-            } else if (*format == 'B') {
-                bool arg = va_arg(args, int);
-                if (arg)
-                    dd->dis_puts("true");
-                else
-                    dd->dis_puts("false");
-            }
-        } else
-            dd->dis_putc(*format);
-
-        format++;
-    }
-
+    int ret = printf_format(&out, format, args);
     va_end(args);
-    return 0;
+
+    printf_flush_dis(&out);
+    return ret;
 }
 
-/** composes a string with the same text that would be printed if format was used on printf, but instead of being printed, 
- * the content is stored as a C string in the buffer pointed by str. 
+/** composes a string with the same text that would be printed if format was used on printf, but instead of being printed,
+ * the content is stored as a C string in the buffer pointed by str.
  * 
  * @param str: buffer to store formatted string in
  * @param format: string to format
@@ -117,51 +118,386 @@ int kprintf(const char *format, ...) {
  * @return number of characters written, excluding the null terminator
  */
 int sprintf(char *str, const char *format, ...) {
-    int chars_written = 0;
     va_list args;
     va_start(args, format);
+    int ret = vsnprintf(str, SIZE_MAX, format, args);
+    va_end(args);
+
+    return ret;
+}
 
+/** formats a string into str, writing at most size characters including the null terminator
+ * 
+ * @param str: buffer to store formatted string in
+ * @param size: size of str
+ * @param format: string to format, see vsnprintf
+ * @param ...: argument for each formatting specifier
+ * 
+ * @return number of characters the formatted string has, excluding the null terminator,
+ *         output was truncated if this is size or more
+ */
+int snprintf(char *str, size_t size, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int ret = vsnprintf(str, size, format, args);
+    va_end(args);
+
+    return ret;
+}
+
+/** formats a string into str, writing at most size characters including the null terminator
+ * Format specifiers are %[flags][width][.precision][length]conversion
+ *  - flags: '-' left justify, '0' zero pad, '+' always sign, ' ' space for sign, '#' 0x/0 prefix
+ *  - width/precision: a number, or '*' to take it from the arguments
+ *  - length: hh, h, l, ll, z
+ *  - conversions:
+ *      - %d/%i: signed decimal number
+ *      - %u: unsigned decimal number
+ *      - %x/%X: unsigned hexadecimal number
+ *      - %o: unsigned octal number
+ *      - %p: pointer, as 0x followed by hex digits
+ *      - %s: null-terminated string
+ *      - %c: character
+ *      - %B: boolean value as a string
+ *      - %%: a percent sign
+ * 
+ * @param str: buffer to store formatted string in
+ * @param size: size of str
+ * @param format: string to format
+ * @param args: argument for each formatting specifier
+ * 
+ * @return number of characters the formatted string has, excluding the null terminator,
+ *         output was truncated if this is size or more
+ */
+int vsnprintf(char *str, size_t size, const char *format, va_list args) {
+    struct printf_out out = {str, size, 0, 0, NULL, NULL};
+    int ret = printf_format(&out, format, args);
+
+    if (size > 0)
+        str[out.pos] = '\0';
+
+    return ret;
+}
+
+/** prints a string with a newline to the screen
+ * 
+ * @param string: null-terminated string to print
+*/
+void kprintln(char *string) {
+    kprint(string);
+    kprint("\n");
+}
+
+/* static functions */
+
+/** formats format into out
+ * 
+ * @param out: where to send the formatted output
+ * @param format: string to format, see vsnprintf
+ * @param args: argument for each formatting specifier
+ * 
+ * @return number of characters produced
+ */
+static int printf_format(struct printf_out *out, const char *format, va_list args) {
     while (*format != '\0') {
-        if (*format == '%') {
+        if (*format != '%') {
+            // copy runs of literal characters in one go
+            const char *lit = format;
+            while (*format != '\0' && *format != '%')
+                format++;
+            printf_write(out, lit, format - lit);
+            continue;
+        }
+
+        const char *spec = format++;
+        int flags = 0;
+        int width = 0;
+        int prec = -1;
+
+        for (;; format++) {
+            if (*format == '-')
+                flags |= FMT_LEFT;
+            else if (*format == '0')
+                flags |= FMT_ZERO;
+            else if (*format == '+')
+                flags |= FMT_PLUS;
+            else if (*format == ' ')
+                flags |= FMT_SPACE;
+            else if (*format == '#')
+                flags |= FMT_ALT;
+            else
+                break;
+        }
+
+        if (*format == '*') {
+            width = va_arg(args, int);
+            if (width < 0) {
+                flags |= FMT_LEFT;
+                width = -width;
+            }
+            format++;
+        } else {
+            while (*format >= '0' && *format <= '9')
+                width = width * 10 + (*format++ - '0');
+        }
+
+        if (*format == '.') {
             format++;
-            const char *temp = NULL;
-
-            if (*format == 'd')
-                temp = int_to_string(va_arg(args, int));
-            else if (*format == 'x')
-                temp = int_to_hexstring(va_arg(args, int));
-            else if (*format == 's')
-                temp = va_arg(args, char *);
-            else if (*format == 'B') 
-                temp = va_arg(args, bool) ? "true" : "false";
-            else {
+            prec = 0;
+            if (*format == '*') {
+                prec = va_arg(args, int);
                 format++;
-                continue;
+            } else {
+                while (*format >= '0' && *format <= '9')
+                    prec = prec * 10 + (*format++ - '0');
             }
+        }
 
-            int len = strlen(temp);
-            strncpy(str, temp, len);
-            str += len;
-            chars_written += len;
-        } else {
-            *str = *format;
-            str++;
-            chars_written++;
+        // number of longs, -1 for short and -2 for char
+        int length = 0;
+        if (*format == 'h') {
+            length = -1;
+            if (*++format == 'h') {
+                length = -2;
+                format++;
+            }
+        } else if (*format == 'l') {
+            length = 1;
+            if (*++format == 'l') {
+                length = 2;
+                format++;
+            }
+        } else if (*format == 'z') {
+            length = 1;
+            format++;
         }
 
+        char conv = *format;
+        if (conv == '\0') {
+            printf_write(out, spec, format - spec);
+            break;
+        }
         format++;
+
+        if (conv == 'd' || conv == 'i') {
+            int64_t val;
+            if (length == 2)
+                val = va_arg(args, long long);
+            else if (length == 1)
+                val = va_arg(args, long);
+            else
+                val = va_arg(args, int);
+
+            if (length == -1)
+                val = (short) val;
+            else if (length == -2)
+                val = (signed char) val;
+
+            printf_num(out, val < 0 ? -(uint64_t) val : (uint64_t) val, val < 0, 10, flags, width, prec);
+        } else if (conv == 'u' || conv == 'x' || conv == 'X' || conv == 'o') {
+            uint64_t val;
+            if (length == 2)
+                val = va_arg(args, unsigned long long);
+            else if (length == 1)
+                val = va_arg(args, unsigned long);
+            else
+                val = va_arg(args, unsigned int);
+
+            if (length == -1)
+                val = (unsigned short) val;
+            else if (length == -2)
+                val = (unsigned char) val;
+
+            if (conv == 'X')
+                flags |= FMT_UPPER;
+
+            unsigned base = conv == 'u' ? 10 : (conv == 'o' ? 8 : 16);
+            printf_num(out, val, false, base, flags & ~(FMT_PLUS | FMT_SPACE), width, prec);
+        } else if (conv == 'p') {
+            uintptr_t val = (uintptr_t) va_arg(args, void *);
+            printf_num(out, val, false, 16, (flags & ~(FMT_PLUS | FMT_SPACE)) | FMT_ALT, width, prec);
+        } else if (conv == 's' || conv == 'B') {
+            const char *str;
+            if (conv == 'B')
+                str = va_arg(args, int) ? "true" : "false";
+            else
+                str = va_arg(args, const char *);
+
+            if (str == NULL)
+                str = "(null)";
+
+            size_t len;
+            if (prec >= 0) {
+                const char *end = memchr(str, '\0', prec);
+                len = end ? (size_t) (end - str) : (size_t) prec;
+            } else
+                len = strlen(str);
+
+            int pad = width > (int) len ? width - (int) len : 0;
+            if (!(flags & FMT_LEFT))
+                printf_pad(out, ' ', pad);
+            printf_write(out, str, len);
+            if (flags & FMT_LEFT)
+                printf_pad(out, ' ', pad);
+        } else if (conv == 'c') {
+            int pad = width > 1 ? width - 1 : 0;
+            if (!(flags & FMT_LEFT))
+                printf_pad(out, ' ', pad);
+            printf_putc(out, (char) va_arg(args, int));
+            if (flags & FMT_LEFT)
+                printf_pad(out, ' ', pad);
+        } else if (conv == '%') {
+            printf_putc(out, '%');
+        } else {
+            // unknown conversion, print it as is
+            printf_write(out, spec, format - spec);
+        }
     }
 
-    *str = '\0';
+    return out->total;
+}
 
-    return chars_written;
+/** formats an integer into out
+ * 
+ * @param out: where to send the formatted number
+ * @param val: magnitude of the number
+ * @param neg: whether the number is negative
+ * @param base: base to print the number in, 8, 10 or 16
+ * @param flags: FMT_* flags
+ * @param width: minimum number of characters to print
+ * @param prec: minimum number of digits to print, -1 if not given
+ */
+static void printf_num(struct printf_out *out, uint64_t val, bool neg, unsigned base, int flags, int width, int prec) {
+    char buf[U64TOA_BUF_SIZE + 2];
+    char *p = buf;
+    int ndigits = 0;
+
+    // a precision of 0 prints no digits for 0
+    if (val != 0 || prec != 0) {
+        if (base == 10) {
+            ndigits = u64toa(val, buf);
+        } else if (base == 16) {
+            ndigits = u64tohex(val, buf, flags & FMT_UPPER);
+        } else {
+            char *end = buf + sizeof(buf);
+            p = end;
+            do {
+                *--p = '0' + (val & 7);
+                val >>= 3;
+            } while (val != 0);
+            ndigits = end - p;
+        }
+    }
+
+    char prefix[3];
+    int nprefix = 0;
+    if (neg)
+        prefix[nprefix++] = '-';
+    else if (flags & FMT_PLUS)
+        prefix[nprefix++] = '+';
+    else if (flags & FMT_SPACE)
+        prefix[nprefix++] = ' ';
+
+    if ((flags & FMT_ALT) && base == 16) {
+        prefix[nprefix++] = '0';
+        prefix[nprefix++] = (flags & FMT_UPPER) ? 'X' : 'x';
+    } else if ((flags & FMT_ALT) && base == 8 && prec <= ndigits && (ndigits == 0 || *p != '0')) {
+        prefix[nprefix++] = '0';
+    }
+
+    int zeros = prec > ndigits ? prec - ndigits : 0;
+    if (prec < 0 && (flags & FMT_ZERO) && !(flags & FMT_LEFT) && width > nprefix + ndigits)
+        zeros = width - nprefix - ndigits;
+
+    int len = nprefix + zeros + ndigits;
+    int pad = width > len ? width - len : 0;
+
+    if (!(flags & FMT_LEFT))
+        printf_pad(out, ' ', pad);
+    printf_write(out, prefix, nprefix);
+    printf_pad(out, '0', zeros);
+    printf_write(out, p, ndigits);
+    if (flags & FMT_LEFT)
+        printf_pad(out, ' ', pad);
 }
 
-/** prints a string with a newline to the screen 
+/** adds a character to out
  * 
- * @param string: null-terminated string to print
-*/
-void kprintln(char *string) {
-    get_default_dis_driver()->dis_puts(string);
-    get_default_dis_driver()->dis_putc('\n');
-}
\ No newline at end of file
+ * @param out: where to add c
+ * @param c: character to add
+ */
+static void printf_putc(struct printf_out *out, char c) {
+    printf_write(out, &c, 1);
+}
+
+/** adds n characters at s to out, flushing it whenever its buffer fills
+ * characters that don't fit in a buffer without a flush function are counted but dropped
+ * 
+ * @param out: where to add s
+ * @param s: characters to add
+ * @param n: number of characters to add
+ */
+static void printf_write(struct printf_out *out, const char *s, size_t n) {
+    out->total += n;
+
+    while (n > 0) {
+        // one slot is always kept for the null terminator
+        size_t room = out->size > out->pos + 1 ? out->size - out->pos - 1 : 0;
+        if (room == 0) {
+            if (out->flush == NULL)
+                return;
+
+            out->flush(out);
+            continue;
+        }
+
+        size_t cnt = n < room ? n : room;
+        memcpy(out->buf + out->pos, s, cnt);
+        out->pos += cnt;
+        s += cnt;
+        n -= cnt;
+    }
+}
+
+/** adds n copies of c to out
+ * 
+ * @param out: where to add the padding
+ * @param c: character to pad with
+ * @param n: number of characters to add, nothing is added if n <= 0
+ */
+static void printf_pad(struct printf_out *out, char c, int n) {
+    char pad[16];
+    memset(pad, c, sizeof(pad));
+
+    while (n > 0) {
+        int cnt = n < (int) sizeof(pad) ? n : (int) sizeof(pad);
+        printf_write(out, pad, cnt);
+        n -= cnt;
+    }
+}
+
+/** draws the buffered output of out to the screen with kprint
+ * 
+ * @param out: output to flush
+ */
+static void printf_flush_dis(struct printf_out *out) {
+    if (out->pos == 0)
+        return;
+
+    out->buf[out->pos] = '\0';
+    kprint(out->buf);
+    out->pos = 0;
+}
+
+/** writes the buffered output of out to the std_stream in out->aux
+ * 
+ * @param out: output to flush
+ */
+static void printf_flush_std(struct printf_out *out) {
+    if (out->pos == 0)
+        return;
+
+    out->buf[out->pos] = '\0';
+    puts_std((std_stream *) out->aux, out->buf);
+    out->pos = 0;
+}
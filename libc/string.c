@@ -2,19 +2,159 @@
 
 /* includes */
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <mem.h>
+#include <dispatch.h>
+#include "../kernel/cpu.h"
 
 /* defines */
+#define WORD_ONES 0x01010101u
+#define WORD_HIGHS 0x80808080u
+// nonzero if any byte of w is zero, the lowest set bit marks the first zero byte
+#define WORD_HAS_ZERO(w) (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+#define WORD_ALIGNED(p) (((uintptr_t) (p) & 3) == 0)
+#define STRLEN_CHUNK 4096   // bytes scanned with SSE2 per window of disabled interrupts
+
+typedef uint32_t __attribute__ ((may_alias)) word_t;
 
 /* globals */
 static char *oldstr;
 
+static const char digit_pairs[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+static const char hex_lower[] = "0123456789abcdef";
+static const char hex_upper[] = "0123456789ABCDEF";
+
+/* prototypes */
+static size_t utoa_pad9(uint32_t val, char *buf);
+
 /* functions */
 
 /* THIS FILE NEEDS TO BE REVISED TO CONFORM TO C99 */
 
+/** converts an unsigned 32 bit number into a decimal string
+ * digits are produced two at a time from a lookup table
+ * NOTE: not a stdlib function
+ * 
+ * @param val: number to convert
+ * @param buf: buffer to store the string in, must hold at least UTOA_BUF_SIZE chars
+ * 
+ * @return length of the string, excluding the null terminator
+ */
+size_t utoa(uint32_t val, char *buf) {
+    size_t len = 1;
+    uint32_t v;
+    for (v = val; v >= 10; v /= 10)
+        len++;
+    
+    char *p = buf + len;
+    *p = '\0';
+
+    while (val >= 100) {
+        const char *pair = digit_pairs + (val % 100) * 2;
+        val /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+
+    if (val >= 10) {
+        *--p = digit_pairs[val * 2 + 1];
+        *--p = digit_pairs[val * 2];
+    } else
+        *--p = '0' + val;
+
+    return len;
+}
+
+/** converts an unsigned long into a decimal string
+ * NOTE: not a stdlib function
+ * 
+ * @param val: number to convert
+ * @param buf: buffer to store the string in, must hold at least UTOA_BUF_SIZE chars
+ * 
+ * @return length of the string, excluding the null terminator
+ */
+size_t ultoa(unsigned long val, char *buf) {
+    return utoa(val, buf);
+}
+
+/** converts an unsigned 64 bit number into a decimal string
+ * the number is split into 9 digit pieces so that only 32 bit division is
+ * needed for the digits themselves
+ * NOTE: not a stdlib function
+ * 
+ * @param val: number to convert
+ * @param buf: buffer to store the string in, must hold at least U64TOA_BUF_SIZE chars
+ * 
+ * @return length of the string, excluding the null terminator
+ */
+size_t u64toa(uint64_t val, char *buf) {
+    if (val <= UINT32_MAX)
+        return utoa((uint32_t) val, buf);
+    
+    uint32_t low = val % 1000000000;
+    uint64_t high = val / 1000000000;
+
+    size_t len;
+    if (high <= UINT32_MAX) {
+        len = utoa((uint32_t) high, buf);
+    } else {
+        len = utoa((uint32_t) (high / 1000000000), buf);
+        len += utoa_pad9((uint32_t) (high % 1000000000), buf + len);
+    }
+
+    len += utoa_pad9(low, buf + len);
+    buf[len] = '\0';
+    return len;
+}
+
+/** converts an unsigned 32 bit number into a hex string, without a 0x prefix
+ * NOTE: not a stdlib function
+ * 
+ * @param val: number to convert
+ * @param buf: buffer to store the string in, must hold at least HEX_BUF_SIZE chars
+ * @param upper: whether to use uppercase hex digits
+ * 
+ * @return length of the string, excluding the null terminator
+ */
+size_t utohex(uint32_t val, char *buf, bool upper) {
+    return u64tohex(val, buf, upper);
+}
+
+/** converts an unsigned 64 bit number into a hex string, without a 0x prefix
+ * NOTE: not a stdlib function
+ * 
+ * @param val: number to convert
+ * @param buf: buffer to store the string in, must hold at least HEX_BUF_SIZE chars
+ * @param upper: whether to use uppercase hex digits
+ * 
+ * @return length of the string, excluding the null terminator
+ */
+size_t u64tohex(uint64_t val, char *buf, bool upper) {
+    const char *digits = upper ? hex_upper : hex_lower;
+
+    size_t len = 1;
+    uint64_t v;
+    for (v = val >> 4; v != 0; v >>= 4)
+        len++;
+    
+    buf[len] = '\0';
+
+    // the low word is done separately to avoid 64 bit shifts
+    uint32_t lo = (uint32_t) val;
+    uint32_t hi = (uint32_t) (val >> 32);
+    size_t i;
+    for (i = len; i > 0; i--) {
+        buf[i - 1] = digits[lo & 0xf];
+        lo = (lo >> 4) | (hi << 28);
+        hi >>= 4;
+    }
+
+    return len;
+}
+
 /** converts an int n into an ascii string str
+ * not reentrant, use utoa with a caller owned buffer instead
  * NOTE: not a stdlib function
  * 
  * @param n: number to convert
@@ -22,21 +162,19 @@ static char *oldstr;
  * @return converted number as a string
  */
 char *int_to_string(int n) {
-    int i = 0;
-    static char str[32];
+    static char str[UTOA_BUF_SIZE + 1];
 
-    int num = n;
-    do {
-        str[i++] = num % 10 + '0';
-    } while ((num /= 10) > 0);
+    if (n < 0) {
+        str[0] = '-';
+        utoa(-(uint32_t) n, str + 1);
+    } else
+        utoa(n, str);
     
-    str[i] = '\0';
-
-    reverse(str);
     return str;
 }
 
 /** converts an int n into an ascii hex string 
+ * not reentrant, use utohex with a caller owned buffer instead
  * NOTE: not a stdlib function
  * 
  * @param n: number to convert
@@ -44,22 +182,11 @@ char *int_to_string(int n) {
  * @return converted number as a string
  */
 char *int_to_hexstring(int n) {
-    int i = 0;
-    static char str[32];
-
-    int num = n;
-    do {
-        if (num % 16 >= 10)
-            str[i++] = ((num - 10) % 16) + 'a';
-        else
-            str[i++] = num % 16 + '0';
-    } while ((num /= 16) > 0);
+    static char str[HEX_BUF_SIZE + 2];
 
-    str[i++] = 'x';
-    str[i++] = '0';
-    str[i] = '\0';
-
-    reverse(str);
+    str[0] = '0';
+    str[1] = 'x';
+    utohex(n, str + 2, false);
     return str;
 }
 
@@ -76,10 +203,24 @@ char *int_to_hexstring(int n) {
  *         NULL if it doesn't exist
  */
 void *memchr(const void *ptr, int c, size_t num) {
-    size_t i;
-    for (i = 0; i < num; i++, ptr++)
-        if (*((const char *) ptr) == (unsigned char) c)
-            return (void *) ptr + i;
+    const unsigned char *p = (const unsigned char *) ptr;
+    unsigned char ch = (unsigned char) c;
+
+    for (; num > 0 && !WORD_ALIGNED(p); num--, p++)
+        if (*p == ch)
+            return (void *) p;
+    
+    // xor turns bytes equal to ch into zero bytes
+    uint32_t mask = ch * WORD_ONES;
+    for (; num >= 4; num -= 4, p += 4) {
+        uint32_t w = *(const word_t *) p ^ mask;
+        if (WORD_HAS_ZERO(w))
+            return (void *) (p + (__builtin_ctz(WORD_HAS_ZERO(w)) >> 3));
+    }
+
+    for (; num > 0; num--, p++)
+        if (*p == ch)
+            return (void *) p;
     
     return NULL;
 }
@@ -92,16 +233,33 @@ void *memchr(const void *ptr, int c, size_t num) {
  * @return address of c in str, NULL if non-existent
  */
 char *strchr(const char *str, int c) {
-    size_t i;
-    for (i = 0; i < strlen(str) + 1; i++)
-        if (str[i] == (unsigned char) c)
-            return (char *) str + i;
-    
-    return NULL;
+    const char *p = str;
+    char ch = (char) c;
+
+    for (; !WORD_ALIGNED(p); p++) {
+        if (*p == ch)
+            return (char *) p;
+        if (*p == '\0')
+            return NULL;
+    }
+
+    // aligned reads never cross into the page after the terminator
+    uint32_t mask = (unsigned char) ch * WORD_ONES;
+    for (;; p += 4) {
+        uint32_t w = *(const word_t *) p;
+        if (WORD_HAS_ZERO(w) || WORD_HAS_ZERO(w ^ mask))
+            break;
+    }
+
+    for (;; p++) {
+        if (*p == ch)
+            return (char *) p;
+        if (*p == '\0')
+            return NULL;
+    }
 }
 
-/** searches a string for the first occurence of the character c
- * this function is supposed to be reentrant, but isn't currently
+/** searches a string for the last occurence of the character c
  * 
  * @param str: string to search
  * @param c: character to search for
@@ -109,12 +267,17 @@ char *strchr(const char *str, int c) {
  * @return address of c in str, NULL if non-existent
  */
 char *strrchr(const char *str, int c) {
-    int i;
-    for (i = strlen(str) - 1; i > -1; i--)
-        if (str[i] == (unsigned char) c)
-            return (char *) str + i;
+    if ((char) c == '\0')
+        return strchr(str, c);
     
-    return NULL;
+    const char *last = NULL;
+    const char *p;
+    while ((p = strchr(str, c)) != NULL) {
+        last = p;
+        str = p + 1;
+    }
+
+    return (char *) last;
 }
 
 /** calculates the length of the initial segment of str1 which consists of characters in strt2
@@ -152,14 +315,17 @@ size_t strspn(const char *str1, const char *str2) {
  * @return size of substring, 0 if no such substring exists
  */
 size_t strcspn(const char *str1, const char *str2) {
+    size_t len1 = strlen(str1);
+    size_t len2 = strlen(str2);
+
     size_t i;
     size_t j;
-    for (i = 0; i < strlen(str1) + 1; i++)
-        for (j = 0; j < strlen(str2) + 1; j++) 
+    for (i = 0; i < len1 + 1; i++)
+        for (j = 0; j < len2 + 1; j++) 
             if (str1[i] == str2[j])
                 return i;
     
-    return strlen(str1);
+    return len1;
 }
 
 /** finds the first occurence of string str2 in string str1
@@ -297,19 +463,83 @@ char *strncat(char *dest, const char *src, size_t num) {
     return dest;
 }
 
-/** returns the length of a null-terminated string 
+/** returns the length of a null-terminated string using the best variant for the CPU
  * 
  * @param str: string to calculate the length of
  * 
  * @return number of characters in str
  */
 size_t strlen(const char *str) {
+    return dispatch.strlen(str);
+}
 
-    int i = 0;
-    while (str[i] != 0)
-        i++;
+/** returns the length of a null-terminated string, checking 4 bytes at a time
+ * 
+ * @param str: string to calculate the length of
+ * 
+ * @return number of characters in str
+ */
+size_t strlen_base(const char *str) {
+    const char *p = str;
+
+    for (; !WORD_ALIGNED(p); p++)
+        if (*p == '\0')
+            return p - str;
+    
+    // aligned reads never cross into the page after the terminator
+    uint32_t zeros;
+    while ((zeros = WORD_HAS_ZERO(*(const word_t *) p)) == 0)
+        p += 4;
+
+    return (p - str) + (__builtin_ctz(zeros) >> 3);
+}
+
+/** returns the length of a null-terminated string, checking 16 bytes at a time with SSE2
+ * the reads are 16 byte aligned, so they never cross into a page past the end of str,
+ * and interrupts are let in every STRLEN_CHUNK bytes
+ * 
+ * @param str: string to calculate the length of
+ * 
+ * @return number of characters in str
+ */
+__attribute__ ((target ("sse2")))
+size_t strlen_sse2(const char *str) {
+    const char *p = (const char *) ((uintptr_t) str & ~15);
+    uint32_t mask;
+
+    // xmm registers aren't saved on context switches
+    uint32_t flags = cpu_irq_save();
+    asm volatile("pxor %%xmm0, %%xmm0\n\t"
+                 "movdqa (%1), %%xmm1\n\t"
+                 "pcmpeqb %%xmm0, %%xmm1\n\t"
+                 "pmovmskb %%xmm1, %0"
+                 : "=r" (mask) : "r" (p) : "xmm0", "xmm1");
     
-    return i;
+    // ignore the bytes before the start of str
+    mask >>= (uintptr_t) str & 15;
+    if (mask != 0) {
+        cpu_irq_restore(flags);
+        return __builtin_ctz(mask);
+    }
+
+    do {
+        p += 16;
+
+        // each compare is self-contained, so nothing in the xmm registers has to survive a switch
+        if (((uintptr_t) p & (STRLEN_CHUNK - 1)) == 0) {
+            cpu_irq_restore(flags);
+            flags = cpu_irq_save();
+        }
+
+        asm volatile("pxor %%xmm0, %%xmm0\n\t"
+                     "movdqa (%1), %%xmm1\n\t"
+                     "pcmpeqb %%xmm0, %%xmm1\n\t"
+                     "pmovmskb %%xmm1, %0"
+                     : "=r" (mask) : "r" (p) : "xmm0", "xmm1");
+    } while (mask == 0);
+    cpu_irq_restore(flags);
+
+    return (p - str) + __builtin_ctz(mask);
 }
 
 /** compares the string at str1 to the string at str2 
@@ -320,14 +550,25 @@ size_t strlen(const char *str) {
  * @return the difference between the first differing character in str1 and str2, 0 if there are none
  */
 int strcmp(const char *str1, const char *str2) {
-    int i;
-    // this should probably make sure we don't read garbage if str1 
-    // is longer than str2
-    for (i = 0; str1[i] == str2[i]; i++) {
-        if (str1[i] == '\0') 
-            return 0;
+    const unsigned char *s1 = (const unsigned char *) str1;
+    const unsigned char *s2 = (const unsigned char *) str2;
+
+    // words can only be compared if both strings can be aligned at once
+    if (((uintptr_t) s1 & 3) == ((uintptr_t) s2 & 3)) {
+        for (; !WORD_ALIGNED(s1); s1++, s2++)
+            if (*s1 != *s2 || *s1 == '\0')
+                return *s1 - *s2;
+        
+        while (*(const word_t *) s1 == *(const word_t *) s2 && !WORD_HAS_ZERO(*(const word_t *) s1)) {
+            s1 += 4;
+            s2 += 4;
+        }
     }
-    return str1[i] - str2[i];
+
+    for (; *s1 == *s2 && *s1 != '\0'; s1++, s2++)
+        ;
+    
+    return *s1 - *s2;
 }
 
 /** compares the first n characters string at str1 to the string at str2 
@@ -339,14 +580,25 @@ int strcmp(const char *str1, const char *str2) {
  * @return the difference between the first differing character in the first n characters in
  *         str1 and str2, 0 if there are none
  */
-int strncmp(const char *s1, const char *s2, size_t n) {
-    size_t i;
-    for (i = 0; i < n && s1[i] == s2[i]; i++) {
-        if (s1[i] == '\0') 
-            return 0;
+int strncmp(const char *str1, const char *str2, size_t n) {
+    const unsigned char *s1 = (const unsigned char *) str1;
+    const unsigned char *s2 = (const unsigned char *) str2;
+
+    if (((uintptr_t) s1 & 3) == ((uintptr_t) s2 & 3)) {
+        for (; n > 0 && !WORD_ALIGNED(s1); n--, s1++, s2++)
+            if (*s1 != *s2 || *s1 == '\0')
+                return *s1 - *s2;
+        
+        for (; n >= 4; n -= 4, s1 += 4, s2 += 4)
+            if (*(const word_t *) s1 != *(const word_t *) s2 || WORD_HAS_ZERO(*(const word_t *) s1))
+                break;
     }
 
-    return s1[i] - s2[i];
+    for (; n > 0; n--, s1++, s2++)
+        if (*s1 != *s2 || *s1 == '\0')
+            return *s1 - *s2;
+    
+    return 0;
 }
 
 /** copies the string at src to the memory at dest
@@ -503,4 +755,28 @@ char *strim(const char *str, char *buf) {
     
     buf[k] = '\0';
     return buf;
-}
\ No newline at end of file
+}
+
+/* static functions */
+
+/** writes val as exactly 9 decimal digits, padded with leading zeros
+ * 
+ * @param val: number to convert, less than 1000000000
+ * @param buf: buffer to store the digits in, isn't null-terminated
+ * 
+ * @return number of digits written (always 9)
+ */
+static size_t utoa_pad9(uint32_t val, char *buf) {
+    char *p = buf + 9;
+
+    int i;
+    for (i = 0; i < 4; i++) {
+        const char *pair = digit_pairs + (val % 100) * 2;
+        val /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    *--p = '0' + val;
+
+    return 9;
+}
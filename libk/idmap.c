@@ -0,0 +1,152 @@
+/* Implementation of the id map. Ids are tracked in a two level bitmap: one bit per id
+ * and one summary bit per word of ids that is set when the word is full. Allocation finds
+ * the first non-full summary word, then the first free id in the word it points to, so
+ * allocating and freeing only touch a couple of words. Each id also indexes directly into
+ * an array of objects for constant time lookups. */
+
+/* includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <idmap.h>
+#include <kerrors.h>
+#include <mem.h>
+#include "../kernel/kalloc.h"
+
+/* defines */
+#define IDMAP_ROUND_UP(x, size) (((x + size - 1) / size) * size)
+#define IDMAP_FULL_WORD 0xFFFFFFFF
+
+/* globals */
+
+/* functions */
+
+/** initializes an id map that can hold capacity ids
+ * capacity is rounded up to a multiple of IDMAP_WORD_BITS
+ * 
+ * @param m: id map to initialize
+ * @param capacity: number of ids the map can hold
+ * 
+ * @return -IDMAP_INIT_FAIL on failure, IDMAP_SUCC otherwise
+ */
+int idmap_init(idmap_t *m, size_t capacity) {
+    if (m == NULL || capacity == 0)
+        return -IDMAP_INIT_FAIL;
+
+    capacity = IDMAP_ROUND_UP(capacity, IDMAP_WORD_BITS);
+    size_t used_words = capacity / IDMAP_WORD_BITS;
+    size_t full_words = IDMAP_ROUND_UP(used_words, IDMAP_WORD_BITS) / IDMAP_WORD_BITS;
+
+    // everything is kept in one allocation: objs, then used, then full
+    size_t bytes = capacity * sizeof(void *) + (used_words + full_words) * sizeof(uint32_t);
+    size_t pages = IDMAP_ROUND_UP(bytes, PG_SIZE) / PG_SIZE;
+    uint8_t *mem = (uint8_t *) palloc_mult(pages);
+    if (mem == NULL)
+        return -IDMAP_INIT_FAIL;
+    
+    memset(mem, 0, pages * PG_SIZE);
+
+    m->objs = (void **) mem;
+    m->used = (uint32_t *) (mem + capacity * sizeof(void *));
+    m->full = m->used + used_words;
+    m->capacity = capacity;
+    m->count = 0;
+
+    return IDMAP_SUCC;
+}
+
+/** allocates the lowest free id in the map and maps it to obj
+ * 
+ * @param m: id map to allocate from
+ * @param obj: object to map the new id to
+ * 
+ * @return allocated id, -IDMAP_FULL if there are no free ids
+ */
+int32_t idmap_alloc(idmap_t *m, void *obj) {
+    size_t used_words = m->capacity / IDMAP_WORD_BITS;
+    size_t full_words = IDMAP_ROUND_UP(used_words, IDMAP_WORD_BITS) / IDMAP_WORD_BITS;
+
+    size_t i;
+    for (i = 0; i < full_words; i++) {
+        if (m->full[i] == IDMAP_FULL_WORD)
+            continue;
+        
+        size_t word = i * IDMAP_WORD_BITS + __builtin_ctz(~m->full[i]);
+
+        // the last summary word can point past the end of the map
+        if (word >= used_words)
+            break;
+        
+        size_t bit = __builtin_ctz(~m->used[word]);
+        m->used[word] |= (uint32_t) 1 << bit;
+
+        if (m->used[word] == IDMAP_FULL_WORD)
+            m->full[i] |= (uint32_t) 1 << (word % IDMAP_WORD_BITS);
+
+        uint32_t id = word * IDMAP_WORD_BITS + bit;
+        m->objs[id] = obj;
+        m->count++;
+
+        return id;
+    }
+
+    return -IDMAP_FULL;
+}
+
+/** frees an id previously allocated from the map
+ * 
+ * @param m: id map to free from
+ * @param id: id to free
+ * 
+ * @return -IDMAP_FREE_FAIL if id isn't allocated, IDMAP_SUCC otherwise
+ */
+int idmap_free(idmap_t *m, uint32_t id) {
+    if (!idmap_test(m, id))
+        return -IDMAP_FREE_FAIL;
+    
+    size_t word = id / IDMAP_WORD_BITS;
+    m->used[word] &= ~((uint32_t) 1 << (id % IDMAP_WORD_BITS));
+    m->full[word / IDMAP_WORD_BITS] &= ~((uint32_t) 1 << (word % IDMAP_WORD_BITS));
+    m->objs[id] = NULL;
+    m->count--;
+
+    return IDMAP_SUCC;
+}
+
+/** gets the object mapped to id
+ * 
+ * @param m: id map to search
+ * @param id: id to look up
+ * 
+ * @return object mapped to id, NULL if id isn't allocated
+ */
+void *idmap_get(idmap_t *m, uint32_t id) {
+    if (id >= m->capacity)
+        return NULL;
+
+    return m->objs[id];
+}
+
+/** checks whether id is allocated
+ * 
+ * @param m: id map to search
+ * @param id: id to check
+ * 
+ * @return true if id is allocated, false otherwise
+ */
+bool idmap_test(idmap_t *m, uint32_t id) {
+    if (id >= m->capacity)
+        return false;
+
+    return (m->used[id / IDMAP_WORD_BITS] & ((uint32_t) 1 << (id % IDMAP_WORD_BITS))) != 0;
+}
+
+/** gets the number of allocated ids in the map
+ * 
+ * @param m: id map to get count of
+ * 
+ * @return number of allocated ids
+ */
+size_t idmap_count(idmap_t *m) {
+    return m->count;
+}
@@ -187,7 +187,7 @@ void slab_print_list(slab_alloc_t *s) {
     kprintf("number of slabs total: %d\n", num_slabs);
     uint32_t i = 0;
     while (i < num_slabs) {
-        kprintf("slab %d: %x | mem: %x | free: %B\n", i, slab, slab->addr, slab->free);
+        kprintf("slab %d: %p | mem: %p | free: %B\n", i, slab, slab->addr, slab->free);
         slab++;
         i++;
     }
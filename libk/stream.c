@@ -1,28 +1,41 @@
-/* Implementation of the stream data structure. Streams are implemented by a circular queue as of now */
+/* Implementation of the stream data structure. Streams are implemented by a circular queue as of now,
+ * std_streams are sized to a power of 2 so indexes can be masked instead of taken modulo the size,
+ * char_streams grow when they fill up */
 
 /* includes */
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <mem.h>
+#include <kerrors.h>
 #include "../kernel/kalloc.h"
+#include "../kernel/cpu.h"
 #include "stream.h"
 
 /* defines */
 
 /* globals */
 
+/* prototypes */
+static size_t stream_round_size(size_t size);
+
 /* functions */
 
 /** initializes a char_stream with given size 
  * 
  * @param stream: stream to initialize
- * @param size: size of stream
+ * @param size: initial size of stream, the stream grows when it fills up
  * 
- * @return pointer to stream
+ * @return pointer to stream, NULL if the buffer couldn't be allocated
  */
 char_stream *init_c(char_stream *stream, size_t size) {
+    if (size < CHAR_STREAM_MIN_SIZE)
+        size = CHAR_STREAM_MIN_SIZE;
+
     stream->stream = (char *) kcalloc(size, sizeof(char));
+    if (stream->stream == NULL)
+        return NULL;
+
     stream->size = size;
     stream->in = stream->out = 0;
 
@@ -41,14 +54,15 @@ void flush_c(char_stream *stream) {
 }
 
 /** puts char c into char_stream stream
+ * the stream doubles in size when it is full, keeping its contents in order
  * 
  * @param stream: stream to input to
  * @param c: character to input
  * 
- * @return 1 on success, 0 otherwise
+ * @return 1 on success, 0 if the stream was full and couldn't grow
  */
 int put_c(char_stream *stream, char c) {
-    if(stream->in == ((stream->out - 1 + stream->size) % stream->size))
+    if (count_c(stream) == stream->size - 1 && resize_c(stream, stream->size * 2) < 0)
         return 0; /* Queue Full*/
 
     stream->stream[stream->in] = c;
@@ -59,15 +73,21 @@ int put_c(char_stream *stream, char c) {
 }
 
 /** returns the address of a char array that has the contents of char_stream stream in it
+ * the contents are copied oldest first and null terminated, the stream isn't changed
  * this array needs to be freed with kfree() when done with 
  * 
  * @param stream: stream to copy
  * 
- * @return pointer to copy of stream
+ * @return pointer to copy of stream, NULL if the copy couldn't be allocated
  */
 char *get_copy_c(char_stream *stream) {
-    char *chars = (char *) kcalloc(stream->size, sizeof(char));
-    memcpy(chars, stream->stream, stream->size);
+    size_t count = count_c(stream);
+    char *chars = (char *) kmalloc(count + 1);
+    if (chars == NULL)
+        return NULL;
+
+    snapshot_c(stream, chars, count);
+    chars[count] = 0;
     return chars;
 }
 
@@ -88,15 +108,33 @@ char get_c(char_stream *stream) {
     return old;
 }
 
-/** resizes the size of a char_stream to size
- * this function destroys the contents of the given stream 
+/** resizes a char_stream to size, keeping its contents in order
  * 
  * @param stream: stream to resize
- * @param size: new size of stream
+ * @param size: new size of stream, one more than the number of chars it can hold
+ * 
+ * @return STREAM_SUCC on success, -STREAM_RESIZE_FAIL if the contents don't fit
+ *         or the new buffer couldn't be allocated
  */
-void resize_c(char_stream *stream , size_t size) {
+int resize_c(char_stream *stream, size_t size) {
+    size_t count = count_c(stream);
+
+    if (size <= count || size < CHAR_STREAM_MIN_SIZE)
+        return -STREAM_RESIZE_FAIL;
+
+    char *buf = (char *) kcalloc(size, sizeof(char));
+    if (buf == NULL)
+        return -STREAM_RESIZE_FAIL;
+
+    snapshot_c(stream, buf, count);
     kfree(stream->stream);
-    stream = init_c(stream, size);
+
+    stream->stream = buf;
+    stream->size = size;
+    stream->out = 0;
+    stream->in = count;
+
+    return STREAM_SUCC;
 }
 
 /** frees the underlying char stream within the given char_stream
@@ -105,33 +143,130 @@ void resize_c(char_stream *stream , size_t size) {
  */
 void destroy_c(char_stream *stream) {
     kfree(stream->stream);
+    stream->stream = NULL;
+    stream->size = stream->in = stream->out = 0;
+}
+
+/** gets the number of chars in a char_stream
+ * 
+ * @param stream: stream to check
+ * 
+ * @return number of chars that can be read from stream
+ */
+size_t count_c(char_stream *stream) {
+    return (stream->in + stream->size - stream->out) % stream->size;
+}
+
+/** copies up to n of the oldest chars in a char_stream into buf without removing them
+ * only the live part of the buffer is copied, with at most two memcpys
+ * 
+ * @param stream: stream to copy from
+ * @param buf: buffer to copy into
+ * @param n: max number of chars to copy
+ * 
+ * @return number of chars copied
+ */
+size_t snapshot_c(char_stream *stream, char *buf, size_t n) {
+    size_t count = count_c(stream);
+    if (n > count)
+        n = count;
+
+    size_t first = stream->size - stream->out;
+    if (first > n)
+        first = n;
+
+    memcpy(buf, stream->stream + stream->out, first);
+    memcpy(buf + first, stream->stream, n - first);
+
+    return n;
 }
 
 /* std_stream functions */
 
-/** initializes a std_stream with given size 
+/** initializes a std_stream with the default size of STD_STREAM_SIZE
  * 
  * @param stream: stream to initialize
- * @param size: size of stream
  * 
- * @return pointer to stream
+ * @return pointer to stream, NULL if the buffer couldn't be allocated
  */
 std_stream *init_std(std_stream *stream) {
-    stream->size = STD_STREAM_SIZE;
+    return init_std_size(stream, STD_STREAM_SIZE);
+}
+
+/** initializes a std_stream with given size 
+ * 
+ * @param stream: stream to initialize
+ * @param size: size of stream, rounded up to a power of 2
+ * 
+ * @return pointer to stream, NULL if the buffer couldn't be allocated
+ */
+std_stream *init_std_size(std_stream *stream, size_t size) {
+    size = stream_round_size(size);
+
+    stream->stream = (char *) kmalloc(size);
+    if (stream->stream == NULL)
+        return NULL;
+
+    stream->size = size;
+    stream->mask = size - 1;
     stream->in = stream->out = 0;
+    stream->nonblock = stream->backpressure = stream->closed = false;
+    wait_queue_init(&stream->readers);
+    wait_queue_init(&stream->writers);
 
     return stream;
 }
 
+/** resizes a std_stream, keeping its contents
+ * 
+ * @param stream: stream to resize
+ * @param size: new size of stream, rounded up to a power of 2
+ * 
+ * @return STREAM_SUCC on success, -STREAM_RESIZE_FAIL if the contents don't fit
+ *         or the new buffer couldn't be allocated
+ */
+int resize_std(std_stream *stream, size_t size) {
+    size = stream_round_size(size);
+    size_t count = stream_count(stream);
+
+    if (size < count)
+        return -STREAM_RESIZE_FAIL;
+    
+    char *buf = (char *) kmalloc(size);
+    if (buf == NULL)
+        return -STREAM_RESIZE_FAIL;
+    
+    stream_read(stream, buf, count);
+    kfree(stream->stream);
+
+    stream->stream = buf;
+    stream->size = size;
+    stream->mask = size - 1;
+    stream->out = 0;
+    stream->in = count;
+
+    return STREAM_SUCC;
+}
+
+/** frees the buffer of a std_stream
+ * 
+ * @param stream: stream to destroy, its buffer can be NULL if it was never allocated
+ */
+void destroy_std(std_stream *stream) {
+    if (stream->stream != NULL)
+        kfree(stream->stream);
+    stream->stream = NULL;
+    stream->size = stream->mask = 0;
+    stream->in = stream->out = 0;
+}
+
 /** flushes std_stream stream
  * 
  * @param stream: stream to flush
  */
 void flush_std(std_stream *stream) {
-    size_t i;
-    for (i = 0; i < stream->size; i++)
-        stream->stream[i] = 0;
     stream->in = stream->out = 0;
+    wait_queue_wake_all(&stream->writers);
 }
 
 /** puts char c into std_stream stream
@@ -142,17 +277,18 @@ void flush_std(std_stream *stream) {
  * @return 0 on success, -1 otherwise
  */
 int put_std(std_stream *stream, char c) {
-    if(stream->in == ((stream->out - 1 + STD_STREAM_SIZE) % STD_STREAM_SIZE))
+    if (stream_space(stream) == 0)
         return -1; /* Queue Full*/
 
-    stream->stream[stream->in] = c;
-
-    stream->in = (stream->in + 1) % STD_STREAM_SIZE;
+    stream->stream[stream->in & stream->mask] = c;
+    stream->in++;
+    wait_queue_wake_all(&stream->readers);
 
     return 0;
 }
 
 /** puts string s into std_stream stream
+ * waits for space in streams with backpressure, otherwise chars that don't fit are dropped
  * 
  * @param stream: stream to input to
  * @param s: string to input
@@ -160,23 +296,35 @@ int put_std(std_stream *stream, char c) {
  * @return number of characters input to stream
  */
 int puts_std(std_stream *stream, char *s) {
-    size_t len = strlen(s);
-    size_t i;
-    for (i = 0; i < len && put_std(stream, s[i]) == 0; i++);
+    if (stream->backpressure)
+        return stream_write_wait(stream, s, strlen(s));
 
-    return i;
+    return stream_write(stream, s, strlen(s));
 }
 
 /** returns the address of a char array that has the contents of std_stream stream in it
- * this array needs to be freed with kfree() when done with 
+ * the contents are copied oldest first and null terminated, the stream isn't changed
+ * the array is static and is overwritten by the next call
  * 
  * @param stream: stream to copy
  * 
- * @return pointer to copy of stream
+ * @return pointer to copy of stream, holding at most STD_STREAM_SIZE - 1 chars
  */
 char *get_copy_std(std_stream *stream) {
     static char cp[STD_STREAM_SIZE];
-    memcpy(cp, stream->stream, STD_STREAM_SIZE);
+    size_t n = stream_count(stream);
+    if (n > STD_STREAM_SIZE - 1)
+        n = STD_STREAM_SIZE - 1;
+
+    size_t idx = stream->out & stream->mask;
+    size_t first = stream->size - idx;
+    if (first > n)
+        first = n;
+
+    memcpy(cp, stream->stream + idx, first);
+    memcpy(cp + first, stream->stream, n - first);
+    cp[n] = 0;
+
     return cp;
 }
 
@@ -187,12 +335,286 @@ char *get_copy_std(std_stream *stream) {
  * @return oldest char in stream
  */
 char get_std(std_stream *stream) {
-    if(stream->in == stream->out)
+    if (stream->in == stream->out)
         return -1; /* Queue Empty - nothing to get*/
 
-    char old = stream->stream[stream->out];
-
-    stream->out = (stream->out + 1) % STD_STREAM_SIZE;
+    char old = stream->stream[stream->out & stream->mask];
+    stream->out++;
+    wait_queue_wake_all(&stream->writers);
 
     return old;
-}
\ No newline at end of file
+}
+
+/** gets the oldest char from std_stream stream without removing it
+ * 
+ * @param stream: stream to peek at
+ * 
+ * @return oldest char in stream, -1 if stream is empty
+ */
+char peek_std(std_stream *stream) {
+    if (stream->in == stream->out)
+        return -1;
+
+    return stream->stream[stream->out & stream->mask];
+}
+
+/* std_stream bulk functions */
+
+/** writes up to n chars from buf to stream
+ * copies with at most two memcpys, one on each side of the wrap point
+ * 
+ * @param stream: stream to write to
+ * @param buf: chars to write
+ * @param n: number of chars to write
+ * 
+ * @return number of chars written, less than n if stream filled up
+ */
+size_t stream_write(std_stream *stream, const char *buf, size_t n) {
+    size_t space = stream_space(stream);
+    if (n > space)
+        n = space;
+    
+    size_t idx = stream->in & stream->mask;
+    size_t first = stream->size - idx;
+    if (first > n)
+        first = n;
+    
+    memcpy(stream->stream + idx, buf, first);
+    memcpy(stream->stream, buf + first, n - first);
+    stream->in += n;
+
+    if (n > 0)
+        wait_queue_wake_all(&stream->readers);
+
+    return n;
+}
+
+/** reads up to n chars from stream into buf
+ * copies with at most two memcpys, one on each side of the wrap point
+ * 
+ * @param stream: stream to read from
+ * @param buf: buffer to read into
+ * @param n: max number of chars to read
+ * 
+ * @return number of chars read, less than n if stream emptied
+ */
+size_t stream_read(std_stream *stream, char *buf, size_t n) {
+    size_t count = stream_count(stream);
+    if (n > count)
+        n = count;
+    
+    size_t idx = stream->out & stream->mask;
+    size_t first = stream->size - idx;
+    if (first > n)
+        first = n;
+    
+    memcpy(buf, stream->stream + idx, first);
+    memcpy(buf + first, stream->stream, n - first);
+    stream->out += n;
+
+    if (n > 0)
+        wait_queue_wake_all(&stream->writers);
+
+    return n;
+}
+
+/** gets the number of chars in a std_stream
+ * 
+ * @param stream: stream to check
+ * 
+ * @return number of chars that can be read from stream
+ */
+size_t stream_count(std_stream *stream) {
+    return stream->in - stream->out;
+}
+
+/** gets the amount of free space in a std_stream
+ * 
+ * @param stream: stream to check
+ * 
+ * @return number of chars that can be written to stream
+ */
+size_t stream_space(std_stream *stream) {
+    return stream->size - (stream->in - stream->out);
+}
+
+/* std_stream zero-copy functions */
+
+/** lends out the oldest chars in a std_stream without copying them
+ * the chars stay in the stream until they are consumed with stream_commit_read,
+ * and the rest can be peeked at after that if the contents wrap around the buffer
+ * 
+ * @param stream: stream to peek at
+ * @param ptr: set to the oldest char in stream
+ * @param len: set to the number of chars readable from ptr, 0 if stream is empty
+ */
+void stream_peek_read(std_stream *stream, const char **ptr, size_t *len) {
+    size_t idx = stream->out & stream->mask;
+    size_t n = stream_count(stream);
+
+    if (n > stream->size - idx)
+        n = stream->size - idx;
+
+    *ptr = stream->stream + idx;
+    *len = n;
+}
+
+/** consumes chars lent out by stream_peek_read
+ * 
+ * @param stream: stream to consume from
+ * @param n: number of chars to consume, at most the number in stream
+ */
+void stream_commit_read(std_stream *stream, size_t n) {
+    size_t count = stream_count(stream);
+    if (n > count)
+        n = count;
+
+    stream->out += n;
+
+    if (n > 0)
+        wait_queue_wake_all(&stream->writers);
+}
+
+/** lends out free space in a std_stream to write into directly
+ * the chars written aren't in the stream until they are added with stream_commit_write,
+ * and more space can be reserved after that if the free space wraps around the buffer
+ * 
+ * @param stream: stream to write to
+ * @param ptr: set to the first free char in stream
+ * @param len: set to the number of chars writable from ptr, 0 if stream is full
+ */
+void stream_reserve_write(std_stream *stream, char **ptr, size_t *len) {
+    size_t idx = stream->in & stream->mask;
+    size_t n = stream_space(stream);
+
+    if (n > stream->size - idx)
+        n = stream->size - idx;
+
+    *ptr = stream->stream + idx;
+    *len = n;
+}
+
+/** adds chars written into space lent out by stream_reserve_write to a std_stream
+ * 
+ * @param stream: stream to add to
+ * @param n: number of chars to add, at most the free space in stream
+ */
+void stream_commit_write(std_stream *stream, size_t n) {
+    size_t space = stream_space(stream);
+    if (n > space)
+        n = space;
+
+    stream->in += n;
+
+    if (n > 0)
+        wait_queue_wake_all(&stream->readers);
+}
+
+/* std_stream blocking functions */
+
+/** reads up to n chars from stream into buf, blocking while stream is empty
+ * readers sleep on the stream's wait queue and are woken by writes, so an idle
+ * reader costs nothing until data arrives or its timeout runs out
+ * 
+ * @param stream: stream to read from
+ * @param buf: buffer to read into
+ * @param n: max number of chars to read
+ * @param timeout: max number of timer ticks to block for, 0 blocks until data arrives
+ * 
+ * @return number of chars read, 0 if stream is closed and empty, -STREAM_WOULD_BLOCK if
+ *         stream is empty and nonblocking, -STREAM_TIMEOUT if no data arrived before the timeout
+ */
+int stream_read_wait(std_stream *stream, char *buf, size_t n, uint32_t timeout) {
+    if (n == 0)
+        return 0;
+
+    while (true) {
+        // the check and the sleep have to be atomic with respect to writers in IRQs
+        uint32_t flags = cpu_irq_save();
+        size_t count = stream_read(stream, buf, n);
+
+        if (count > 0 || stream->closed) {
+            cpu_irq_restore(flags);
+            return count;
+        }
+
+        if (stream->nonblock) {
+            cpu_irq_restore(flags);
+            return -STREAM_WOULD_BLOCK;
+        }
+
+        if (wait_queue_sleep(&stream->readers, timeout) < 0) {
+            cpu_irq_restore(flags);
+            return -STREAM_TIMEOUT;
+        }
+
+        cpu_irq_restore(flags);
+    }
+}
+
+/** writes all n chars from buf to stream, blocking while stream is full
+ * writers sleep on the stream's wait queue and are woken by reads
+ * 
+ * @param stream: stream to write to
+ * @param buf: chars to write
+ * @param n: number of chars to write
+ * 
+ * @return number of chars written, less than n only if stream was closed
+ */
+size_t stream_write_wait(std_stream *stream, const char *buf, size_t n) {
+    size_t written = 0;
+
+    while (true) {
+        uint32_t flags = cpu_irq_save();
+        if (!stream->closed)
+            written += stream_write(stream, buf + written, n - written);
+
+        if (written == n || stream->closed) {
+            cpu_irq_restore(flags);
+            return written;
+        }
+
+        wait_queue_sleep(&stream->writers, 0);
+        cpu_irq_restore(flags);
+    }
+}
+
+/** sets whether reads with stream_read_wait block on an empty stream
+ * setting nonblock wakes blocked readers so they return right away
+ * 
+ * @param stream: stream to change
+ * @param nonblock: true to make reads return -STREAM_WOULD_BLOCK instead of blocking
+ */
+void stream_set_nonblock(std_stream *stream, bool nonblock) {
+    stream->nonblock = nonblock;
+
+    if (nonblock)
+        wait_queue_wake_all(&stream->readers);
+}
+
+/** closes a stream, so blocked readers and writers return
+ * readers still get the chars left in stream, after which waiting reads return 0
+ * 
+ * @param stream: stream to close
+ */
+void stream_close(std_stream *stream) {
+    stream->closed = true;
+    wait_queue_wake_all(&stream->readers);
+    wait_queue_wake_all(&stream->writers);
+}
+
+/* static functions */
+
+/** rounds a stream size up to a power of 2
+ * 
+ * @param size: requested size
+ * 
+ * @return smallest power of 2 that is at least size, and at least 2
+ */
+static size_t stream_round_size(size_t size) {
+    size_t pow = 2;
+    while (pow < size)
+        pow <<= 1;
+    
+    return pow;
+}
@@ -8,6 +8,7 @@
 #include <atomic.h>
 #include <kerrors.h>
 #include "../kernel/thread.h"
+#include "../kernel/cpu.h"
 
 /* defines */
 
@@ -223,3 +224,71 @@ int spin_lock_release(spin_lock_t *sl) {
 
     return -LOCK_REL_SUCC;
 }
+
+/* wait queue functions */
+
+/** initializes an empty wait queue
+ * 
+ * @param wq: wait queue to initialize
+ */
+void wait_queue_init(wait_queue_t *wq) {
+    list_init(&wq->waiters);
+}
+
+/** puts the running thread to sleep on a wait queue until it is woken or times out
+ * interrupts must be disabled by the caller while it checks the condition it waits on,
+ * otherwise a wakeup between the check and the sleep is lost
+ * 
+ * @param wq: wait queue to sleep on
+ * @param timeout: max number of timer ticks to sleep, 0 sleeps until woken
+ * 
+ * @return WAIT_SUCC if the thread was woken, -WAIT_TIMEOUT if it timed out
+ */
+int wait_queue_sleep(wait_queue_t *wq, uint32_t timeout) {
+    struct thread *t = THREAD_CUR();
+
+    list_insert_end(&wq->waiters.tail, &t->wait_node);
+
+    if (thread_block_timeout(timeout)) {
+        uint32_t flags = cpu_irq_save();
+        list_delete(&wq->waiters, &t->wait_node);
+        cpu_irq_restore(flags);
+
+        return -WAIT_TIMEOUT;
+    }
+
+    return WAIT_SUCC;
+}
+
+/** wakes the thread that has slept on a wait queue the longest
+ * safe to call from interrupt handlers
+ * 
+ * @param wq: wait queue to wake a thread from
+ * 
+ * @return true if a thread was woken, false if none were waiting
+ */
+bool wait_queue_wake_one(wait_queue_t *wq) {
+    uint32_t flags = cpu_irq_save();
+    list_node_t *node = list_pop(&wq->waiters);
+
+    if (node != NULL)
+        thread_unblock(LIST_ENTRY(node, struct thread, wait_node));
+
+    cpu_irq_restore(flags);
+    return node != NULL;
+}
+
+/** wakes every thread sleeping on a wait queue
+ * safe to call from interrupt handlers
+ * 
+ * @param wq: wait queue to wake
+ */
+void wait_queue_wake_all(wait_queue_t *wq) {
+    uint32_t flags = cpu_irq_save();
+    list_node_t *node;
+
+    while ((node = list_pop(&wq->waiters)) != NULL)
+        thread_unblock(LIST_ENTRY(node, struct thread, wait_node));
+    
+    cpu_irq_restore(flags);
+}
@@ -0,0 +1,90 @@
+/* Tests the id map */
+
+/* includes */
+#include <stdbool.h>
+#include <stdint.h>
+#include <idmap.h>
+#include <string.h>
+#include <stdio.h>
+#include "tests.h"
+
+/* defines */
+#define NUM_IDMAP_TESTS 3
+#define IDMAP_TEST_CAPACITY 40  // not a multiple of the word size on purpose
+
+/* globals */
+static void idmap_setup(void);
+
+static bool test_alloc(void);
+static bool test_reuse(void);
+static bool test_full(void);
+
+static test_group idmap_test_group;
+static idmap_t test_map;
+static int test_objs[64];
+
+/* functions */
+
+/** initializes the id map test group
+ * 
+ * @return initialized id map test group, with tests added
+ */
+test_group *init_idmap_group(void) {
+    idmap_test_group = TEST_GROUP_INIT("ID Map", idmap_setup, NULL);
+
+    test_function test_funcs[NUM_IDMAP_TESTS] = {test_alloc, test_reuse, test_full};
+    char *test_names[NUM_IDMAP_TESTS] = {"alloc", "reuse", "full"};
+    for (int i = 0; i < NUM_IDMAP_TESTS; i++)
+        add_test(&idmap_test_group, test_funcs[i], test_names[i]);
+    
+    return &idmap_test_group;
+}
+
+/** tests allocating ids and looking them up
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_alloc(void) {
+    CHECK_EQ(idmap_alloc(&test_map, &test_objs[0]), 0, "first id");
+    CHECK_EQ(idmap_alloc(&test_map, &test_objs[1]), 1, "second id");
+    CHECK_EQ(idmap_get(&test_map, 1), &test_objs[1], "lookup of id 1");
+    CHECK_EQ(idmap_get(&test_map, 2), NULL, "lookup of unallocated id");
+    CHECK_EQ(idmap_count(&test_map), 2, "count after two allocations");
+
+    return true;
+}
+
+/** tests that freed ids are handed out again
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_reuse(void) {
+    CHECK_EQ(idmap_free(&test_map, 0), IDMAP_SUCC, "free id 0");
+    CHECK_EQ(idmap_free(&test_map, 0), -IDMAP_FREE_FAIL, "double free of id 0");
+    CHECK_EQ(idmap_get(&test_map, 0), NULL, "lookup of freed id");
+    CHECK_EQ(idmap_alloc(&test_map, &test_objs[2]), 0, "reuse of id 0");
+    CHECK_EQ(idmap_get(&test_map, 0), &test_objs[2], "lookup of reused id");
+
+    return true;
+}
+
+/** tests filling the map past its capacity
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_full(void) {
+    // capacity is rounded up to a whole word
+    for (int i = idmap_count(&test_map); i < 64; i++)
+        CHECK_EQ(idmap_alloc(&test_map, &test_objs[i]), i, "filling map");
+
+    CHECK_EQ(idmap_alloc(&test_map, NULL), -IDMAP_FULL, "allocation from full map");
+    CHECK_EQ(idmap_free(&test_map, 33), IDMAP_SUCC, "free from full map");
+    CHECK_EQ(idmap_alloc(&test_map, &test_objs[33]), 33, "allocation after free from full map");
+
+    return true;
+}
+
+/** initializes the map used by the id map tests */
+static void idmap_setup(void) {
+    idmap_init(&test_map, IDMAP_TEST_CAPACITY);
+}
@@ -0,0 +1,221 @@
+/* Tests the stream data structures */
+
+/* includes */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stream.h>
+#include <string.h>
+#include <mem.h>
+#include <stdio.h>
+#include "../kernel/kalloc.h"
+#include "tests.h"
+
+/* defines */
+#define NUM_STREAM_TESTS 7
+#define STREAM_TEST_SIZE 12 // not a power of 2 on purpose
+
+/* globals */
+static void stream_setup(void);
+static void stream_teardown(void);
+
+static bool test_wrap(void);
+static bool test_full(void);
+static bool test_resize(void);
+static bool test_nonblock(void);
+static bool test_close(void);
+static bool test_char_grow(void);
+static bool test_zero_copy(void);
+
+static test_group stream_test_group;
+static std_stream test_stream;
+
+/* functions */
+
+/** initializes the stream test group
+ * 
+ * @return initialized stream test group, with tests added
+ */
+test_group *init_stream_group(void) {
+    stream_test_group = TEST_GROUP_INIT("Stream", stream_setup, stream_teardown);
+
+    test_function test_funcs[NUM_STREAM_TESTS] = {test_wrap, test_full, test_resize, test_nonblock, test_close, test_char_grow, test_zero_copy};
+    char *test_names[NUM_STREAM_TESTS] = {"wrap", "full", "resize", "nonblock", "close", "char grow", "zero copy"};
+    for (int i = 0; i < NUM_STREAM_TESTS; i++)
+        add_test(&stream_test_group, test_funcs[i], test_names[i]);
+    
+    return &stream_test_group;
+}
+
+/** tests bulk reads and writes that cross the end of the buffer
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_wrap(void) {
+    char buf[16];
+
+    CHECK_EQ(test_stream.size, 16, "size rounded up to a power of 2");
+    CHECK_EQ(stream_write(&test_stream, "0123456789", 10), 10, "first write");
+    CHECK_EQ(stream_read(&test_stream, buf, 8), 8, "first read");
+    CHECK_EQ(stream_write(&test_stream, "abcdefghij", 10), 10, "write across the end");
+    CHECK_EQ(stream_count(&test_stream), 12, "count after wrapping");
+    CHECK_EQ(stream_read(&test_stream, buf, sizeof(buf)), 12, "read across the end");
+    CHECK_EQ(memcmp(buf, "89abcdefghij", 12), 0, "contents after wrapping");
+    CHECK_EQ(get_std(&test_stream), -1, "get from empty stream");
+
+    return true;
+}
+
+/** tests writing to a full stream
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_full(void) {
+    CHECK_EQ(stream_write(&test_stream, "0123456789abcdefXYZ", 19), 16, "write past capacity");
+    CHECK_EQ(stream_space(&test_stream), 0, "space in full stream");
+    CHECK_EQ(put_std(&test_stream, 'x'), -1, "put to full stream");
+    CHECK_EQ(get_std(&test_stream), '0', "get from full stream");
+    CHECK_EQ(put_std(&test_stream, 'x'), 0, "put after get");
+
+    return true;
+}
+
+/** tests that resizing keeps the contents of a stream in order
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_resize(void) {
+    char buf[32];
+
+    CHECK_EQ(resize_std(&test_stream, 8), -STREAM_RESIZE_FAIL, "shrink below count");
+    CHECK_EQ(resize_std(&test_stream, 32), STREAM_SUCC, "grow");
+    CHECK_EQ(test_stream.size, 32, "size after grow");
+    CHECK_EQ(stream_count(&test_stream), 16, "count after grow");
+    CHECK_EQ(puts_std(&test_stream, "more"), 4, "write after grow");
+    CHECK_EQ(stream_read(&test_stream, buf, sizeof(buf)), 20, "read after grow");
+    CHECK_EQ(memcmp(buf, "123456789abcdefxmore", 20), 0, "contents after grow");
+
+    return true;
+}
+
+/** tests that waiting reads return right away when they can't block
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_nonblock(void) {
+    char buf[8];
+
+    flush_std(&test_stream);
+    stream_set_nonblock(&test_stream, true);
+    CHECK_EQ(stream_read_wait(&test_stream, buf, sizeof(buf), 0), -STREAM_WOULD_BLOCK, "read empty nonblocking stream");
+    CHECK_EQ(puts_std(&test_stream, "abc"), 3, "write to nonblocking stream");
+    CHECK_EQ(stream_read_wait(&test_stream, buf, 2, 0), 2, "read nonblocking stream");
+
+    stream_set_nonblock(&test_stream, false);
+    CHECK_EQ(stream_read_wait(&test_stream, buf + 2, sizeof(buf), 0), 1, "read with data doesn't block");
+    CHECK_EQ(memcmp(buf, "abc", 3), 0, "contents of waiting reads");
+
+    return true;
+}
+
+/** tests that a closed stream can be drained and then reads as empty
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_close(void) {
+    char buf[8];
+
+    flush_std(&test_stream);
+    CHECK_EQ(stream_write_wait(&test_stream, "xyz", 3), 3, "write with space doesn't block");
+    stream_close(&test_stream);
+    CHECK_EQ(stream_write_wait(&test_stream, "more", 4), 0, "write to closed stream");
+    CHECK_EQ(stream_read_wait(&test_stream, buf, sizeof(buf), 0), 3, "drain closed stream");
+    CHECK_EQ(stream_read_wait(&test_stream, buf, sizeof(buf), 0), 0, "read closed empty stream");
+
+    return true;
+}
+
+/** tests that a char_stream grows without losing or reordering its contents
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_char_grow(void) {
+    char_stream cs;
+    char buf[32];
+
+    CHECK_NEQ(init_c(&cs, 4), NULL, "init char_stream");
+    for (int i = 0; i < 3; i++)
+        put_c(&cs, 'a' + i);
+    
+    CHECK_EQ(get_c(&cs), 'a', "get before wrapping");
+    CHECK_EQ(get_c(&cs), 'b', "get before wrapping");
+
+    // wraps around the end of the buffer, then grows while wrapped
+    for (int i = 3; i < 12; i++)
+        CHECK_EQ(put_c(&cs, 'a' + i), 1, "put past the initial size");
+
+    CHECK_EQ(count_c(&cs), 10, "count after growing");
+    CHECK_EQ(snapshot_c(&cs, buf, sizeof(buf)), 10, "snapshot after growing");
+    CHECK_EQ(memcmp(buf, "cdefghijkl", 10), 0, "contents after growing");
+    CHECK_EQ(resize_c(&cs, 10), -STREAM_RESIZE_FAIL, "shrink below count");
+
+    char *copy = get_copy_c(&cs);
+    CHECK_NEQ(copy, NULL, "copy of char_stream");
+    CHECK_EQ(strcmp(copy, "cdefghijkl"), 0, "copy is linearized");
+    kfree(copy);
+
+    CHECK_EQ(get_c(&cs), 'c', "get after growing");
+    destroy_c(&cs);
+
+    return true;
+}
+
+/** tests lending ring memory out to readers and writers across the end of the buffer
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_zero_copy(void) {
+    std_stream s;
+    const char *rptr;
+    char *wptr;
+    char buf[4];
+    size_t len;
+
+    CHECK_NEQ(init_std_size(&s, 8), NULL, "init stream");
+    stream_write(&s, "012345", 6);
+    stream_read(&s, buf, 4);
+
+    stream_reserve_write(&s, &wptr, &len);
+    CHECK_EQ(len, 2, "reserve up to the end of the buffer");
+    memcpy(wptr, "ab", 2);
+    stream_commit_write(&s, 2);
+
+    stream_reserve_write(&s, &wptr, &len);
+    CHECK_EQ(len, 4, "reserve after wrapping");
+    memcpy(wptr, "cd", 2);
+    stream_commit_write(&s, 2);
+
+    stream_peek_read(&s, &rptr, &len);
+    CHECK_EQ(len, 4, "peek up to the end of the buffer");
+    CHECK_EQ(memcmp(rptr, "45ab", 4), 0, "peeked contents");
+    stream_commit_read(&s, 4);
+
+    stream_peek_read(&s, &rptr, &len);
+    CHECK_EQ(len, 2, "peek after wrapping");
+    CHECK_EQ(memcmp(rptr, "cd", 2), 0, "peeked contents after wrapping");
+    CHECK_EQ(strcmp(get_copy_std(&s), "cd"), 0, "copy of live contents");
+    stream_commit_read(&s, 8);
+    CHECK_EQ(stream_count(&s), 0, "commit more than the stream holds");
+
+    destroy_std(&s);
+    return true;
+}
+
+/** initializes the stream used by the stream tests */
+static void stream_setup(void) {
+    init_std_size(&test_stream, STREAM_TEST_SIZE);
+}
+
+/** frees the stream used by the stream tests */
+static void stream_teardown(void) {
+    destroy_std(&test_stream);
+}
@@ -0,0 +1,226 @@
+/* Tests the terminal's escape sequence parser against a fake display driver */
+
+/* includes */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <mem.h>
+#include <stdio.h>
+#include "../drivers/terminal.h"
+#include "tests.h"
+
+/* defines */
+#define NUM_TERMINAL_TESTS 4
+#define FAKE_COLS 10
+#define FAKE_ROWS 4
+
+/* globals */
+static void terminal_setup(void);
+static void terminal_reset(void);
+
+static bool test_batch(void);
+static bool test_cursor(void);
+static bool test_sgr(void);
+static bool test_erase(void);
+
+static void fake_setcur(uint32_t x, uint32_t y);
+static uint32_t fake_getx(void);
+static uint32_t fake_gety(void);
+static uint32_t fake_getn_cols(void);
+static uint32_t fake_getn_rows(void);
+static void fake_write(const char *s, size_t n);
+static void fake_erase(uint32_t x, uint32_t y, uint32_t n);
+static void fake_setcol(uint32_t fg, uint32_t bg);
+
+static test_group terminal_test_group;
+static term_t test_term;
+static line_disc_t test_ld;
+static display_t fake_dis;
+
+// what the fake display was last asked to do
+static char fake_text[32];
+static uint32_t fake_text_len, fake_writes;
+static uint32_t fake_x, fake_y;
+static uint32_t fake_fg, fake_bg;
+static uint32_t fake_erase_x, fake_erase_y, fake_erase_n;
+
+/* functions */
+
+/** initializes the terminal test group
+ * 
+ * @return initialized terminal test group, with tests added
+ */
+test_group *init_terminal_group(void) {
+    terminal_test_group = TEST_GROUP_INIT("Terminal", terminal_setup, NULL);
+
+    test_function test_funcs[NUM_TERMINAL_TESTS] = {test_batch, test_cursor, test_sgr, test_erase};
+    char *test_names[NUM_TERMINAL_TESTS] = {"batch", "cursor", "sgr", "erase"};
+    for (int i = 0; i < NUM_TERMINAL_TESTS; i++)
+        add_test(&terminal_test_group, test_funcs[i], test_names[i]);
+
+    return &terminal_test_group;
+}
+
+/** tests that text between escape sequences is drawn with one call per run
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_batch(void) {
+    terminal_reset();
+
+    char *s = "abc\x1b[2Cdef";
+
+    test_term.term_writen(&test_term, s, strlen(s));
+    CHECK_EQ(fake_writes, 2, "one draw before and one after the sequence");
+    CHECK_EQ(fake_text_len, 6, "length of the text drawn");
+    CHECK_EQ(memcmp(fake_text, "abcdef", 6), 0, "text drawn without the sequence");
+
+    // a sequence split across writes is still parsed
+    test_term.term_writen(&test_term, "\x1b[", 2);
+    test_term.term_writen(&test_term, "1;1H", 4);
+    CHECK_EQ(fake_writes, 2, "no text drawn for a split sequence");
+    CHECK_EQ(fake_x, 0, "x after split sequence");
+    CHECK_EQ(fake_y, 0, "y after split sequence");
+
+    return true;
+}
+
+/** tests the cursor movement sequences and that they stay on the screen
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_cursor(void) {
+    terminal_reset();
+
+    test_term.term_writes(&test_term, "\x1b[3;5H");
+    CHECK_EQ(fake_x, 4, "x after CUP");
+    CHECK_EQ(fake_y, 2, "y after CUP");
+
+    test_term.term_writes(&test_term, "\x1b[A\x1b[2D");
+    CHECK_EQ(fake_x, 2, "x after CUB");
+    CHECK_EQ(fake_y, 1, "y after CUU");
+
+    test_term.term_writes(&test_term, "\x1b[99B\x1b[99C");
+    CHECK_EQ(fake_x, FAKE_COLS - 1, "x clamped to the screen");
+    CHECK_EQ(fake_y, FAKE_ROWS - 1, "y clamped to the screen");
+
+    test_term.term_writes(&test_term, "\x1b[s\x1b[H\x1b[u");
+    CHECK_EQ(fake_x, FAKE_COLS - 1, "x after restore");
+    CHECK_EQ(fake_y, FAKE_ROWS - 1, "y after restore");
+
+    return true;
+}
+
+/** tests setting colors with SGR sequences
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_sgr(void) {
+    terminal_reset();
+
+    test_term.term_writes(&test_term, "\x1b[31;44m");
+    CHECK_EQ(fake_fg, 0xAA0000, "red foreground");
+    CHECK_EQ(fake_bg, 0x0000AA, "blue background");
+
+    test_term.term_writes(&test_term, "\x1b[1m");
+    CHECK_EQ(fake_fg, 0xFF5555, "bold makes the foreground bright");
+
+    test_term.term_writes(&test_term, "\x1b[m");
+    CHECK_EQ(fake_fg, 0xFFFFFF, "default foreground after reset");
+    CHECK_EQ(fake_bg, 0x000000, "default background after reset");
+
+    return true;
+}
+
+/** tests erasing the line and the screen
+ * 
+ * @return false if test fails, true if test passes
+ */
+static bool test_erase(void) {
+    terminal_reset();
+
+    test_term.term_writes(&test_term, "\x1b[2;4H\x1b[K");
+    CHECK_EQ(fake_erase_x, 3, "EL starts at the cursor");
+    CHECK_EQ(fake_erase_y, 1, "EL is on the cursor's row");
+    CHECK_EQ(fake_erase_n, FAKE_COLS - 3, "EL erases to the end of the line");
+
+    test_term.term_writes(&test_term, "\x1b[J");
+    CHECK_EQ(fake_erase_n, (FAKE_ROWS - 1) * FAKE_COLS - 3, "ED erases to the end of the screen");
+
+    test_term.term_writes(&test_term, "\x1b[2J");
+    CHECK_EQ(fake_erase_x, 0, "ED 2 starts at the top left");
+    CHECK_EQ(fake_erase_y, 0, "ED 2 starts at the top left");
+    CHECK_EQ(fake_erase_n, FAKE_ROWS * FAKE_COLS, "ED 2 erases the whole screen");
+    CHECK_EQ(fake_x, 3, "ED doesn't move the cursor");
+
+    return true;
+}
+
+/** sets up the terminal for the group, setup only runs once per group */
+static void terminal_setup(void) {
+    terminal_reset();
+}
+
+/** connects a fresh terminal to a fake display with the cursor at the top left
+ * every test calls this first, so the tests don't depend on the order they run in
+ */
+static void terminal_reset(void) {
+    memset(&fake_dis, 0, sizeof(fake_dis));
+    fake_dis.dis_setcur = fake_setcur;
+    fake_dis.dis_getx = fake_getx;
+    fake_dis.dis_gety = fake_gety;
+    fake_dis.dis_getn_cols = fake_getn_cols;
+    fake_dis.dis_getn_rows = fake_getn_rows;
+    fake_dis.dis_write = fake_write;
+    fake_dis.dis_erase = fake_erase;
+    fake_dis.dis_setcol = fake_setcol;
+
+    fake_text_len = fake_writes = 0;
+    fake_x = fake_y = 0;
+    fake_fg = fake_bg = 0;
+    fake_erase_x = fake_erase_y = fake_erase_n = 0;
+
+    terminal_init(&test_term, &test_ld, &fake_dis);
+}
+
+/* fake display driver functions, they record what they were last asked to do */
+
+static void fake_setcur(uint32_t x, uint32_t y) {
+    fake_x = x;
+    fake_y = y;
+}
+
+static uint32_t fake_getx(void) {
+    return fake_x;
+}
+
+static uint32_t fake_gety(void) {
+    return fake_y;
+}
+
+static uint32_t fake_getn_cols(void) {
+    return FAKE_COLS;
+}
+
+static uint32_t fake_getn_rows(void) {
+    return FAKE_ROWS;
+}
+
+static void fake_write(const char *s, size_t n) {
+    for (size_t i = 0; i < n && fake_text_len < sizeof(fake_text); i++)
+        fake_text[fake_text_len++] = s[i];
+
+    fake_writes++;
+}
+
+static void fake_erase(uint32_t x, uint32_t y, uint32_t n) {
+    fake_erase_x = x;
+    fake_erase_y = y;
+    fake_erase_n = n;
+}
+
+static void fake_setcol(uint32_t fg, uint32_t bg) {
+    fake_fg = fg;
+    fake_bg = bg;
+}
@@ -29,6 +29,9 @@ static void run_test_group(test_group *g);
 void init_testing() {
     add_group(init_slab_group);
     add_group(init_proc_group);
+    add_group(init_idmap_group);
+    add_group(init_stream_group);
+    add_group(init_terminal_group);
 }
 
 /** adds a group to be tested
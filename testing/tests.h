@@ -71,5 +71,8 @@ void print_test(char *test_name, bool passed);
 /* test group functions */
 test_group *init_slab_group(void);
 test_group *init_proc_group(void);
+test_group *init_idmap_group(void);
+test_group *init_stream_group(void);
+test_group *init_terminal_group(void);
 
 #endif
\ No newline at end of file